@@ -0,0 +1,122 @@
+#include "Arena.h"
+#include "ThreadKey.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#define ALIGNMENT 8
+#define ALIGN(n) (((n) + ALIGNMENT - 1) & ~size_t(ALIGNMENT - 1))
+
+__thread Arena* Arena::instance = NULL;
+
+// the key destroys the arena of a thread when it exits, the one of the
+// main thread lives as long as the process
+void Arena::Create() {
+	static const pthread_key_t key = NewKey(Destroy);
+	instance = new Arena();
+	pthread_setspecific(key, instance);
+}
+
+void Arena::Destroy(void* arena) {
+	delete static_cast<Arena*>(arena);
+	instance = NULL;
+}
+
+Arena::Arena(size_t cs):
+	current(0),
+	top(NULL),
+	end(NULL),
+	chunkSize(cs),
+	capacity(0),
+	numAllocs(0),
+	numBytes(0),
+	numSystemAllocs(0)
+{
+	chunks.reserve(32);
+}
+
+Arena::~Arena() {
+	for (unsigned int i = 0, n = chunks.size(); i < n; i++)
+		free(chunks[i].data);
+}
+
+void* Arena::Allocate(size_t size) {
+	size = ALIGN(size);
+	if (top == NULL || size_t(end - top) < size)
+		Grow(size);
+
+	void* p = top;
+	top += size;
+	numAllocs++;
+	numBytes += size;
+	return p;
+}
+
+void Arena::Deallocate(void* p, size_t size) {
+	// only the most recent allocation can be given back
+	if (static_cast<char*>(p) + ALIGN(size) == top)
+		top = static_cast<char*>(p);
+}
+
+Arena::Mark Arena::GetMark() const {
+	Mark m;
+	m.chunk = current;
+	m.top   = top;
+	return m;
+}
+
+void Arena::Release(const Mark& m) {
+	current = m.chunk;
+	top     = m.top;
+	end     = (top == NULL)? NULL: chunks[current].data + chunks[current].size;
+}
+
+void Arena::Grow(size_t size) {
+	// reuse a chunk left behind by Release() when it is large enough
+	for (unsigned int i = (top == NULL)? 0: current + 1, n = chunks.size(); i < n; i++)
+	{
+		if (chunks[i].size >= size)
+		{
+			current = i;
+			top = chunks[i].data;
+			end = top + chunks[i].size;
+			return;
+		}
+	}
+
+	Chunk c;
+	c.size = std::max<size_t>(chunkSize, size);
+	c.data = static_cast<char*>(malloc(c.size));
+	if (c.data == NULL)
+		throw std::bad_alloc();
+
+	chunks.push_back(c);
+	current = chunks.size() - 1;
+	top = c.data;
+	end = c.data + c.size;
+	capacity += c.size;
+	numSystemAllocs++;
+}
+
+void Arena::Reset() {
+	// merge all chunks into one so the next turn needs no additional mallocs
+	if (chunks.size() > 1)
+	{
+		for (unsigned int i = 0, n = chunks.size(); i < n; i++)
+			free(chunks[i].data);
+		chunks.clear();
+		chunkSize = capacity;
+		capacity = 0;
+		top = end = NULL;
+		Grow(chunkSize);
+	}
+
+	if (!chunks.empty())
+	{
+		current = 0;
+		top = chunks[0].data;
+		end = top + chunks[0].size;
+	}
+
+	numAllocs = numBytes = numSystemAllocs = 0;
+}
@@ -0,0 +1,137 @@
+#ifndef ARENA_
+#define ARENA_
+
+#include <cstddef>
+#include <new>
+#include <vector>
+#include <map>
+#include <list>
+
+// Bump allocator for all per-turn scratch data. Memory is handed out
+// linearly from a chunk and never freed individually, Reset() releases
+// everything at once. When a turn needed more than one chunk, Reset()
+// merges them into a single chunk of the combined size so that the next
+// turns are served without touching malloc.
+class Arena {
+public:
+	Arena(size_t chunkSize = 1<<20);
+	~Arena();
+
+	// every thread allocates from its own arena, freed when the thread
+	// exits
+	static Arena* Instance() {
+		if (instance == NULL)
+			Create();
+		return instance;
+	}
+
+	void* Allocate(size_t);
+	void  Deallocate(void*, size_t);
+	void  Reset();
+
+	// Position in the arena, everything allocated after it can be released
+	// at once without waiting for the end of the turn
+	struct Mark {
+		unsigned int chunk;
+		char*        top;
+	};
+	Mark GetMark() const;
+	void Release(const Mark&);
+
+	// Releases everything allocated during its lifetime. Containers created
+	// inside the scope must be destroyed before it and containers created
+	// outside it must not grow while it is alive.
+	class Scope {
+	public:
+		Scope(): arena(Arena::Instance()), mark(arena->GetMark()) {}
+		~Scope() { arena->Release(mark); }
+	private:
+		Arena* arena;
+		Mark   mark;
+	};
+
+	size_t NumAllocs() const       { return numAllocs; }       // allocations served this turn
+	size_t NumBytes() const        { return numBytes; }        // bytes handed out this turn
+	size_t NumSystemAllocs() const { return numSystemAllocs; } // mallocs done by the arena this turn
+	size_t Capacity() const        { return capacity; }        // total bytes reserved
+
+private:
+	struct Chunk {
+		char*  data;
+		size_t size;
+	};
+
+	static __thread Arena* instance;
+
+	static void Create();
+	static void Destroy(void* arena);
+
+	std::vector<Chunk> chunks;
+	unsigned int current; // chunk being allocated from
+	char*  top; // next free byte in the current chunk
+	char*  end; // end of the current chunk
+	size_t chunkSize;
+	size_t capacity;
+	size_t numAllocs;
+	size_t numBytes;
+	size_t numSystemAllocs;
+
+	void Grow(size_t);
+};
+
+// STL allocator drawing from the per-turn arena, containers using this
+// allocator must not outlive the turn. Long lived containers are bound to
+// the heap instead by constructing them with ArenaAllocator<T>::Heap(),
+// copies of those containers draw from the arena again.
+template<typename T> class ArenaAllocator {
+public:
+	typedef T         value_type;
+	typedef T*        pointer;
+	typedef const T*  const_pointer;
+	typedef T&        reference;
+	typedef const T&  const_reference;
+	typedef size_t    size_type;
+	typedef ptrdiff_t difference_type;
+
+	template<typename U> struct rebind { typedef ArenaAllocator<U> other; };
+
+	ArenaAllocator(): arena(Arena::Instance()) {}
+	ArenaAllocator(const ArenaAllocator& a): arena(a.arena) {}
+	template<typename U> ArenaAllocator(const ArenaAllocator<U>& a): arena(a.arena) {}
+
+	static ArenaAllocator Heap() { return ArenaAllocator(NULL); }
+	ArenaAllocator select_on_container_copy_construction() const { return ArenaAllocator(); }
+
+	pointer       address(reference x) const       { return &x; }
+	const_pointer address(const_reference x) const { return &x; }
+	size_type     max_size() const                 { return size_t(-1) / sizeof(T); }
+
+	pointer allocate(size_type n, const void* = 0) {
+		if (arena == NULL)
+			return static_cast<pointer>(::operator new(n * sizeof(T)));
+		return static_cast<pointer>(arena->Allocate(n * sizeof(T)));
+	}
+	void deallocate(pointer p, size_type n) {
+		if (arena == NULL)
+			::operator delete(p);
+		else
+			arena->Deallocate(p, n * sizeof(T));
+	}
+
+	void construct(pointer p, const T& t) { new(p) T(t); }
+	void destroy(pointer p)               { p->~T(); }
+
+	template<typename U> bool operator == (const ArenaAllocator<U>& a) const { return arena == a.arena; }
+	template<typename U> bool operator != (const ArenaAllocator<U>& a) const { return arena != a.arena; }
+
+	Arena* arena; // NULL when bound to the heap
+
+private:
+	explicit ArenaAllocator(Arena* a): arena(a) {}
+};
+
+typedef std::vector<int, ArenaAllocator<int> >       IntVec;
+typedef std::vector<double, ArenaAllocator<double> > DoubleVec;
+typedef std::list<unsigned int, ArenaAllocator<unsigned int> > UIntList;
+
+#endif
@@ -0,0 +1,169 @@
+#include "BatchSimulator.h"
+#include "Logger.h"
+
+#include <algorithm>
+
+BatchSimulator::BatchSimulator(PlanetVec& refAP, FleetVec& refAF):
+	AP(refAP),
+	AF(refAF),
+	lanes(0)
+{
+}
+
+int BatchSimulator::AddScenario() {
+	return lanes++;
+}
+
+void BatchSimulator::Launch(int lane, const FleetVec& orders, int owner) {
+	ASSERT(lane >= 0 && lane < lanes);
+	ASSERT(owner == 1 || owner == 2);
+	for (unsigned int i = 0, n = orders.size(); i < n; i++)
+	{
+		const Fleet& o = orders[i];
+		Event e = {o.DestinationPlanet(), o.TurnsRemaining(), lane, owner, o.NumShips()};
+		Launched l = {lane, o.SourcePlanet(), o.NumShips()};
+		events.push_back(e);
+		launched.push_back(l);
+	}
+}
+
+bool BatchSimulator::SortOnPlanetAndTurnsLeft(const Event& a, const Event& b) {
+	if (a.dest == b.dest)
+		return a.turns < b.turns;
+	else
+		return a.dest < b.dest;
+}
+
+// The fleets of one turn land on the planet in all n lanes, growth is added
+// first. Same rules as the Simulator: equal forces of both players that are
+// at least the garrison leave zero ships, otherwise the biggest force fights
+// the rest and then the planet.
+void BatchSimulator::Impact(int* owner, int* ships, const int* force1, const int* force2, int n, int growth) {
+	for (int k = 0; k < n; k++)
+	{
+		const int a = force1[k];
+		const int b = force2[k];
+		const int o = owner[k];
+		const int s = ships[k] + ((o > 0)? growth: 0);
+
+		const int win   = (b > a)? 2: 1;
+		const int force = (b > a)? b - a: a - b;
+		const int diff  = s - force;
+		const bool hit  = a > 0 || b > 0;
+		const bool tie  = a > 0 && a == b && a >= s;
+
+		int no = (o != win && force > s)? win: o;
+		int ns = (o == win)? s + force: ((diff < 0)? -diff: diff);
+		no = (tie || !hit)? o: no;
+		ns = tie? 0: ns;
+		ns = hit? ns: s;
+
+		owner[k] = no;
+		ships[k] = ns;
+	}
+}
+
+void BatchSimulator::Run(int totalTurns) {
+	const int N = AP.size();
+	const int K = lanes;
+	owner.assign(N*K, 0);
+	ships.assign(N*K, 0);
+	score.assign(K, 0);
+	if (K == 0)
+		return;
+
+	// the scenarios only differ on the planets their orders touch
+	IntVec touched(N, 0);
+	for (unsigned int i = 0, n = launched.size(); i < n; i++)
+		touched[launched[i].source] = 1;
+	for (unsigned int i = 0, n = events.size(); i < n; i++)
+		touched[events[i].dest] = 1;
+
+	// fleets still flying at the end count for the score, the others are
+	// merged with the fleets of the scenarios
+	int baseScore = 0;
+	EventVec E;
+	for (unsigned int i = 0, n = AF.size(); i < n; i++)
+	{
+		const Fleet& f = AF[i];
+		ASSERT(f.TurnsRemaining() > 0 && f.Owner() <= 2);
+		if (f.TurnsRemaining() > totalTurns)
+		{
+			baseScore += (f.Owner() == 1)? f.NumShips(): -f.NumShips();
+			continue;
+		}
+		Event e = {f.DestinationPlanet(), f.TurnsRemaining(), -1, f.Owner(), f.NumShips()};
+		E.push_back(e);
+	}
+	for (unsigned int i = 0, n = events.size(); i < n; i++)
+	{
+		const Event& e = events[i];
+		if (e.turns > totalTurns)
+			score[e.lane] += (e.owner == 1)? e.ships: -e.ships;
+		else
+			E.push_back(e);
+	}
+	sort(E.begin(), E.end(), SortOnPlanetAndTurnsLeft);
+
+	IntVec force1(K), force2(K);
+	unsigned int e = 0;
+	for (int i = 0; i < N; i++)
+	{
+		const Planet& p = AP[i];
+		const int n = touched[i]? K: 1;
+		int* o = &owner[i*K];
+		int* s = &ships[i*K];
+		for (int k = 0; k < n; k++)
+		{
+			o[k] = p.Owner();
+			s[k] = p.NumShips();
+		}
+		if (touched[i])
+		{
+			for (unsigned int j = 0, m = launched.size(); j < m; j++)
+				if (launched[j].source == i)
+					s[launched[j].lane] -= launched[j].ships;
+		}
+
+		// all fleets landing in the same turn fight at once
+		int turnsTaken = 0;
+		while (e < E.size() && E[e].dest == i)
+		{
+			const int turns = E[e].turns;
+			std::fill(force1.begin(), force1.begin()+n, 0);
+			std::fill(force2.begin(), force2.begin()+n, 0);
+			for (; e < E.size() && E[e].dest == i && E[e].turns == turns; e++)
+			{
+				IntVec& force = (E[e].owner == 1)? force1: force2;
+				if (E[e].lane == -1)
+				{
+					for (int k = 0; k < n; k++)
+						force[k] += E[e].ships;
+				}
+				else
+				{
+					force[E[e].lane] += E[e].ships;
+				}
+			}
+			Impact(o, s, &force1[0], &force2[0], n, (turns - turnsTaken)*p.GrowthRate());
+			turnsTaken = turns;
+		}
+
+		const int growth = (totalTurns - turnsTaken)*p.GrowthRate();
+		for (int k = 0; k < n; k++)
+			s[k] += (o[k] > 0)? growth: 0;
+
+		// untouched planets are the same in every lane
+		for (int k = n; k < K; k++)
+		{
+			o[k] = o[0];
+			s[k] = s[0];
+		}
+
+		for (int k = 0; k < K; k++)
+			score[k] += (o[k] == 1)? s[k]: ((o[k] > 1)? -s[k]: 0);
+	}
+
+	for (int k = 0; k < K; k++)
+		score[k] += baseScore;
+}
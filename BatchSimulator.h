@@ -0,0 +1,62 @@
+#ifndef BATCHSIMULATOR_H_
+#define BATCHSIMULATOR_H_
+
+#include "PlanetWars.h"
+#include "Arena.h"
+
+#include <vector>
+
+// Simulates many what-if order sets (scenarios) against one base state in a
+// single pass. Every planet evolves on its own in the Simulator, only the
+// fleets heading for it matter. So only the planets touched by the orders
+// of a scenario get state per scenario, kept as one array over all
+// scenarios (lanes), and each fleet impact is resolved for all lanes in the
+// same branch free loop, which the compiler can vectorize. The result of a
+// lane equals Simulator::Start(totalTurns, AP, AF, false, true) on the base
+// state with the orders of that lane launched.
+class BatchSimulator {
+public:
+	BatchSimulator(PlanetVec& AP, FleetVec& AF);
+
+	int  AddScenario(); // returns the lane of the new scenario
+	void Launch(int lane, const FleetVec& orders, int owner); // like Search::Apply
+	void Run(int totalTurns);
+
+	int  Scenarios() const					{ return lanes; }
+	int  Owner(int lane, int i) const		{ return owner[i*lanes + lane]; }
+	int  NumShips(int lane, int i) const	{ return ships[i*lanes + lane]; }
+	bool IsMyPlanet(int lane, int i) const	{ return Owner(lane, i) == 1; }
+	int  GetScore(int lane) const			{ return score[lane]; }
+
+private:
+	struct Event {
+		int dest;
+		int turns;
+		int lane; // -1 for the fleets of the base state
+		int owner;
+		int ships;
+	};
+
+	struct Launched {
+		int lane;
+		int source;
+		int ships;
+	};
+
+	typedef std::vector<Event, ArenaAllocator<Event> >       EventVec;
+	typedef std::vector<Launched, ArenaAllocator<Launched> > LaunchedVec;
+
+	PlanetVec&  AP;
+	FleetVec&   AF;
+	int         lanes;
+	EventVec    events;   // fleets of the scenarios
+	LaunchedVec launched; // ships taken from the sources
+	IntVec      owner;    // planet x lane
+	IntVec      ships;    // planet x lane
+	IntVec      score;    // per lane
+
+	static bool SortOnPlanetAndTurnsLeft(const Event&, const Event&);
+	static void Impact(int* owner, int* ships, const int* force1, const int* force2, int n, int growth);
+};
+
+#endif
@@ -0,0 +1,675 @@
+#include "PlanetWars.h"
+#include "Simulator.h"
+#include "Logger.h"
+#include "Map.h"
+#include "KnapSack.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+#include "Router.h"
+#include "PlanCache.h"
+#include "SimCache.h"
+#include "MCTS.h"
+#include "Strength.h"
+#include "SimBase.h"
+
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <algorithm>
+#include <string>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+
+// Microbenchmarks of the hot paths of the bot. Every benchmark is measured on
+// synthetic game states of growing size and printed as a CSV line
+//
+//   benchmark,planets,fleets,param,ns_per_call,calls
+//
+// so the scaling curves of two builds can be compared. The mcts_threads lines
+// are the playouts of a search of --time seconds on a pool of param threads,
+// in ns per playout. Build with
+// `make bench DEBUG=` to leave out the logging and the asserts. The
+// benchmarks that repeat a call the memos answer run with empty memos,
+// their _hit lines with the memos filled by the calls before. The
+// simulate_base and simulate_planet_base lines share a SimBase of the state
+// over the calls, as the simulations of a turn do, simulate_base over the
+// one turn the timeline looks ahead.
+
+// from MyBot.cc, linked without its main
+void DoTurn(PlanetWars& pw);
+extern __thread ThreadPool* gPool;
+extern __thread int turn;
+
+namespace bench {
+	#include "Helper.inl"
+}
+
+#define MAX_TIME_PER_CALL 1.0e9 // ns, a curve stops after a point this slow
+
+static double gMinTime = 0.05; // seconds per data point, --time
+
+// xorshift, the same seed gives the same scenario on every machine
+class Random {
+public:
+	Random(unsigned int seed): state(seed == 0? 2463534242u: seed) {}
+
+	unsigned int Next() {
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		return state;
+	}
+
+	int    Int(int n)  { return Next() % n; }            // [0, n)
+	double Real()      { return Next() / 4294967296.0; } // [0, 1)
+
+private:
+	unsigned int state;
+};
+
+// Symmetric map with a mid-game fleet state. Planet 0 lies in the center,
+// the other planets come in pairs mirrored through it, planets 1 and 2 are
+// the home planets. Every fleet has a mirrored enemy fleet, as in the maps
+// of the game engine.
+class Scenario {
+public:
+	Scenario(int numPlanets, int numFleets, unsigned int seed) {
+		Random random(seed);
+		const int pairs  = std::max(1, (numPlanets - 1) / 2);
+		const double size = 6.0 * sqrt(double(pairs)) + 10.0; // constant density
+		const double c    = size / 2.0;
+
+		planets.push_back(Body(c, c, 0, 1 + random.Int(50), random.Int(6)));
+		for (int i = 0; i < pairs; i++)
+		{
+			const double x = random.Real() * size;
+			const double y = random.Real() * size;
+			int owner  = 0;
+			int ships  = 1 + random.Int(100);
+			int growth = 1 + random.Int(5);
+			if (i == 0)
+			{
+				owner  = 1;
+				ships  = 100;
+				growth = 5;
+			}
+			else
+			if (random.Int(10) < 3)
+			{
+				owner = 1;
+			}
+			planets.push_back(Body(x, y, owner, ships, growth));
+			planets.push_back(Body(2.0*c - x, 2.0*c - y, owner == 0? 0: 2, ships, growth));
+		}
+
+		IntVec owned(ArenaAllocator<int>::Heap());
+		for (unsigned int i = 0, n = planets.size(); i < n; i++)
+			if (planets[i].owner == 1)
+				owned.push_back(i);
+
+		for (int i = 0; i < numFleets / 2; i++)
+		{
+			const int sid = owned[random.Int(owned.size())];
+			int tid = random.Int(planets.size());
+			if (tid == sid)
+				tid = Mirror(sid);
+			const double dx = planets[sid].x - planets[tid].x;
+			const double dy = planets[sid].y - planets[tid].y;
+			const int trip  = std::max(1, int(ceil(sqrt(dx*dx + dy*dy))));
+			const int ships = 1 + random.Int(50);
+			const int left  = 1 + random.Int(trip);
+			fleets.push_back(Flight(1, ships, sid, tid, trip, left));
+			fleets.push_back(Flight(2, ships, Mirror(sid), Mirror(tid), trip, left));
+		}
+	}
+
+	int NumPlanets() const { return planets.size(); }
+	int NumFleets() const  { return fleets.size(); }
+
+	// game state text after the given number of turns, the fleets fly on
+	// and the owned planets grow, nothing lands
+	std::string ToString(int turns = 0) const {
+		std::ostringstream s;
+		s.precision(10);
+		for (unsigned int i = 0, n = planets.size(); i < n; i++)
+		{
+			const Body& p = planets[i];
+			s << "P " << p.x << " " << p.y << " " << p.owner << " "
+			  << p.ships + (p.owner == 0? 0: turns*p.growth) << " " << p.growth << "\n";
+		}
+		for (unsigned int i = 0, n = fleets.size(); i < n; i++)
+		{
+			const Flight& f = fleets[i];
+			if (f.left - turns > 0)
+				s << "F " << f.owner << " " << f.ships << " " << f.source << " "
+				  << f.destination << " " << f.trip << " " << f.left - turns << "\n";
+		}
+		return s.str();
+	}
+
+private:
+	struct Body {
+		Body(double x_, double y_, int o, int s, int g): x(x_), y(y_), owner(o), ships(s), growth(g) {}
+		double x, y;
+		int owner, ships, growth;
+	};
+
+	struct Flight {
+		Flight(int o, int s, int src, int dst, int t, int l):
+			owner(o), ships(s), source(src), destination(dst), trip(t), left(l) {}
+		int owner, ships, source, destination, trip, left;
+	};
+
+	static int Mirror(int pid) { return pid == 0? 0: (pid % 2 == 1? pid + 1: pid - 1); }
+
+	std::vector<Body>   planets;
+	std::vector<Flight> fleets;
+};
+
+class Benchmark {
+public:
+	virtual ~Benchmark() {}
+	virtual void Run() = 0;
+};
+
+// calls the benchmark in doubling batches until a batch takes gMinTime,
+// every call gets its own arena scope, returns the ns per call
+static double Measure(const char* name, int planets, int fleets, int param, Benchmark& benchmark) {
+	Timer t;
+	long calls = 1;
+	double time = 0.0;
+	while (true)
+	{
+		t.Tick();
+		for (long i = 0; i < calls; i++)
+		{
+			Arena::Scope scope;
+			benchmark.Run();
+		}
+		t.Tock();
+		time = t.Time();
+		if (time >= gMinTime || time * 1.0e9 / calls >= MAX_TIME_PER_CALL)
+			break;
+		calls *= 2;
+	}
+
+	const double ns = time * 1.0e9 / calls;
+	printf("%s,%d,%d,%d,%.1f,%ld\n", name, planets, fleets, param, ns, calls);
+	fflush(stdout);
+	return ns;
+}
+
+// fills the memos with the results of a batch of calls
+static void Warm(Benchmark& benchmark, int calls) {
+	for (int i = 0; i < calls; i++)
+	{
+		Arena::Scope scope;
+		benchmark.Run();
+	}
+}
+
+// The calls of a benchmark on empty memos, every call misses the results
+// of the simulator and the verdicts of the plan cache.
+class ColdBench: public Benchmark {
+public:
+	ColdBench(Benchmark& b): benchmark(b) {}
+	void Run() {
+		PlanCache plans;
+		PlanCache::SetInstance(&plans);
+		SimCache::Instance()->Clear();
+		benchmark.Run();
+		PlanCache::SetInstance(NULL);
+	}
+private:
+	Benchmark& benchmark;
+};
+
+// cout goes nowhere while DoTurn issues its orders
+class NullBuffer: public std::streambuf {
+protected:
+	int overflow(int c) { return c; }
+};
+
+// parsed scenario with the index sets the helpers work on
+struct State {
+	State(const Scenario& s):
+		text(s.ToString()),
+		pw(text),
+		all(ArenaAllocator<int>::Heap()),
+		mine(ArenaAllocator<int>::Heap()),
+		myFleets(ArenaAllocator<int>::Heap())
+	{
+		const PlanetVec& AP = pw.Planets();
+		const FleetVec&  AF = pw.Fleets();
+		for (unsigned int i = 0, n = AP.size(); i < n; i++)
+		{
+			all.push_back(i);
+			if (AP[i].Owner() == 1)
+				mine.push_back(i);
+		}
+		for (unsigned int i = 0, n = AF.size(); i < n; i++)
+			if (AF[i].Owner() == 1)
+				myFleets.push_back(i);
+	}
+
+	std::string text;
+	PlanetWars  pw;
+	IntVec      all, mine, myFleets;
+};
+
+class SimulateBench: public Benchmark {
+public:
+	enum Mode {FULL, PLANET, SCORE};
+
+	SimulateBench(State& s, int h, Mode m = FULL): state(s), horizon(h), mode(m), i(0) {}
+	void Run() {
+		Simulator sim;
+		PlanetVec& AP = state.pw.Planets();
+		FleetVec&  AF = state.pw.Fleets();
+		switch (mode)
+		{
+			case FULL:   sim.Start(horizon, AP, AF, false, true); break;
+			case PLANET: sim.StartPlanet(horizon, AP, AF, i++ % AP.size()); break;
+			case SCORE:  sim.StartScore(horizon, AP, AF); break;
+		}
+	}
+private:
+	State&       state;
+	int          horizon;
+	Mode         mode;
+	unsigned int i;
+};
+
+class MapBench: public Benchmark {
+public:
+	MapBench(State& s): state(s) {}
+	void Run() {
+		Map map(state.pw.Planets());
+	}
+private:
+	State& state;
+};
+
+class MapQueryBench: public Benchmark {
+public:
+	MapQueryBench(State& s, Map& m): state(s), map(m), i(0) {}
+	void Run() {
+		const PlanetVec& AP = state.pw.Planets();
+		const Planet& p = AP[i++ % AP.size()];
+		map.GetClosestPlanetIdx(p.Loc(), state.all);
+		map.GetPlanetIDsInRadius(p.Loc(), state.all, 10);
+		if (!map.GetFrontLine().empty())
+			map.GetClosestFrontLinePlanetIdx(p);
+	}
+private:
+	State&       state;
+	Map&         map;
+	unsigned int i;
+};
+
+class KnapSackBench: public Benchmark {
+public:
+	KnapSackBench(int items, int capacity, unsigned int seed):
+		w(ArenaAllocator<int>::Heap()),
+		v(ArenaAllocator<double>::Heap()),
+		W(capacity)
+	{
+		Random random(seed);
+		for (int i = 0; i < items; i++)
+		{
+			w.push_back(1 + random.Int(100));
+			v.push_back(random.Real());
+		}
+	}
+	void Run() {
+		KnapSack ks(w, v, W);
+		ks.Indices();
+	}
+private:
+	IntVec    w;
+	DoubleVec v;
+	int       W;
+};
+
+// lookups from a few sources, their routes are built before the measurement
+class HubBench: public Benchmark {
+public:
+	HubBench(State& s): state(s), sources(std::min<int>(16, s.mine.size())), i(0) {
+		Router::Instance()->Update(state.pw.Planets());
+		for (int j = 0; j < sources; j++)
+			Router::Instance()->GetHub(state.pw.Planets(), state.mine[j], state.all.back());
+	}
+	void Run() {
+		const int sid = state.mine[i % sources];
+		const int tid = (sid * 7 + i) % state.all.size();
+		i++;
+		if (sid != tid)
+			Router::Instance()->GetHub(state.pw.Planets(), sid, tid);
+	}
+private:
+	State&       state;
+	int          sources;
+	unsigned int i;
+};
+
+// the hops from a few sources to the last planet on the next hop tables of
+// the state, the tables of the hops are built before the measurement
+class PathBench: public Benchmark {
+public:
+	PathBench(State& s): state(s), sources(std::min<int>(16, s.mine.size())), i(0) {
+		Router::Instance()->Update(state.pw.Planets());
+		for (int j = 0; j < sources; j++)
+			Router::Instance()->Path(state.mine[j], state.all.back(), path);
+	}
+	void Run() {
+		Router::Instance()->Path(state.mine[i++ % sources], state.all.back(), path);
+	}
+private:
+	State&           state;
+	int              sources;
+	std::vector<int> path;
+	unsigned int     i;
+};
+
+class StrengthBench: public Benchmark {
+public:
+	StrengthBench(State& s): state(s), i(0) {}
+	void Run() {
+		bench::GetStrength(i++ % state.all.size(), 20, state.mine, state.myFleets);
+	}
+private:
+	State&       state;
+	unsigned int i;
+};
+
+// the weakest planet as seen from each of our planets, the ATTACK scan,
+// either with a GetStrength per pair or on a Strength table built per call
+class WeakestBench: public Benchmark {
+public:
+	WeakestBench(State& s, bool t): state(s), table(t) {}
+	void Run() {
+		const PlanetVec& AP = state.pw.Planets();
+		if (table)
+		{
+			const Strength strength(AP, state.pw.Fleets(), state.all, state.all, state.myFleets);
+			for (unsigned int i = 0, n = state.mine.size(); i < n; i++)
+				strength.Weakest(state.mine[i], NULL);
+			return;
+		}
+		for (unsigned int i = 0, n = state.mine.size(); i < n; i++)
+		{
+			int weakest = std::numeric_limits<int>::max();
+			for (unsigned int j = 0, m = state.all.size(); j < m; j++)
+			{
+				const int tid = state.all[j];
+				const int strength = bench::GetStrength(tid, AP[tid].Distance(AP[state.mine[i]]), state.all, state.myFleets);
+				weakest = std::min(weakest, strength + AP[tid].NumShips());
+			}
+		}
+	}
+private:
+	State& state;
+	bool   table;
+};
+
+class ParseBench: public Benchmark {
+public:
+	ParseBench(const std::string& t): text(t) {}
+	void Run() {
+		PlanetWars pw(text);
+	}
+private:
+	const std::string& text;
+};
+
+// consecutive turns of one game, the delta path of Update
+class UpdateBench: public Benchmark {
+public:
+	UpdateBench(const Scenario& s): i(0) {
+		for (int t = 0; t < 16; t++)
+			texts.push_back(s.ToString(t));
+		pw.Update(texts[0]);
+	}
+	void Run() {
+		pw.Update(texts[++i % texts.size()]);
+	}
+private:
+	std::vector<std::string> texts;
+	PlanetWars   pw;
+	unsigned int i;
+};
+
+class DoTurnBench: public Benchmark {
+public:
+	DoTurnBench(State& s):
+		state(s),
+		AP(ArenaAllocator<Planet>::Heap()),
+		AF(ArenaAllocator<Fleet>::Heap())
+	{
+		AP = s.pw.Planets();
+		AF = s.pw.Fleets();
+	}
+	void Run() {
+		state.pw.Planets() = AP;
+		state.pw.Fleets()  = AF;
+		DoTurn(state.pw);
+	}
+private:
+	State&    state;
+	PlanetVec AP; // the untouched state, DoTurn changes its working copy
+	FleetVec  AF;
+};
+
+// playouts of a search of gMinTime seconds on its own pool, the wall time
+// per playout shows how the playouts scale with the threads
+static void MeasurePlayouts(State& state, int threads) {
+	Arena::Scope scope;
+	Router::Instance()->Update(state.pw.Planets()); // the feed moves take hubs
+	ThreadPool pool(threads);
+	Timer t;
+	t.Tick();
+	MCTS mcts(turn, t, gMinTime);
+	FleetVec candidate, best;
+	mcts.Run(pool, state.pw.Planets(), state.pw.Fleets(), candidate, best);
+	t.Tock();
+	const int playouts = std::max(1, mcts.Playouts());
+	printf("mcts_threads,%d,%d,%d,%.1f,%d\n", int(state.pw.Planets().size()), int(state.pw.Fleets().size()),
+		threads, t.Time() * 1.0e9 / playouts, mcts.Playouts());
+	fflush(stdout);
+}
+
+static bool Selected(const std::string& only, const char* name) {
+	return only.empty() || only == name;
+}
+
+int main(int argc, char *argv[]) {
+	int maxPlanets    = 2000; // --max N
+	unsigned int seed = 1;    // --seed S
+	int threads       = 1;    // --threads N, pool for DoTurn
+	std::string only;         // --only name
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string(argv[i]) == "--max" && i+1 < argc)
+			maxPlanets = atoi(argv[++i]);
+		if (std::string(argv[i]) == "--seed" && i+1 < argc)
+			seed = atoi(argv[++i]);
+		if (std::string(argv[i]) == "--threads" && i+1 < argc)
+			threads = std::max(1, atoi(argv[++i]));
+		if (std::string(argv[i]) == "--time" && i+1 < argc)
+			gMinTime = atof(argv[++i]);
+		if (std::string(argv[i]) == "--only" && i+1 < argc)
+			only = argv[++i];
+	}
+	if (threads > 1)
+		gPool = new ThreadPool(threads);
+
+	#ifdef DEBUG
+	Logger logger("bench.txt");
+	logger.SetLevel(LOG_BASIC);
+	Logger::SetLogger(&logger);
+	#endif
+
+	NullBuffer null;
+	std::streambuf* out = std::cout.rdbuf();
+	turn = 100; // mid-game, DoTurn simulates the remaining turns
+
+	printf("benchmark,planets,fleets,param,ns_per_call,calls\n");
+
+	// the curves over the map size, with as many fleets as planets
+	const int sizes[] = {21, 51, 101, 201, 501, 1001, 2001, 5001, 10001};
+	bool slow[15] = {false};
+	for (unsigned int k = 0; k < sizeof(sizes)/sizeof(sizes[0]) && sizes[k] <= maxPlanets + 1; k++)
+	{
+		const int n = sizes[k];
+		const Scenario scenario(n, n, seed + k);
+		State state(scenario);
+		bench::gAP = &state.pw.Planets();
+		bench::gAF = &state.pw.Fleets();
+		const int p = scenario.NumPlanets();
+		const int f = scenario.NumFleets();
+
+		if (!slow[0] && Selected(only, "parse"))
+		{
+			ParseBench b(state.text);
+			slow[0] = Measure("parse", p, f, 0, b) >= MAX_TIME_PER_CALL;
+		}
+		if (!slow[1] && Selected(only, "update"))
+		{
+			UpdateBench b(scenario);
+			slow[1] = Measure("update", p, f, 0, b) >= MAX_TIME_PER_CALL;
+		}
+		if (!slow[2] && Selected(only, "simulate"))
+		{
+			SimulateBench b(state, 100);
+			slow[2] = Measure("simulate", p, f, 100, b) >= MAX_TIME_PER_CALL;
+		}
+		if (!slow[14] && Selected(only, "simulate_base"))
+		{
+			const SimBase base(state.pw.Fleets(), p);
+			SimBase::Scope bind(&base, state.pw.Fleets());
+			SimulateBench b(state, 1);
+			slow[14] = Measure("simulate_base", p, f, 1, b) >= MAX_TIME_PER_CALL;
+		}
+		if (!slow[8] && Selected(only, "simulate_planet"))
+		{
+			SimulateBench b(state, 100, SimulateBench::PLANET);
+			ColdBench cold(b);
+			slow[8] = Measure("simulate_planet", p, f, 100, cold) >= MAX_TIME_PER_CALL;
+			Warm(b, p);
+			Measure("simulate_planet_hit", p, f, 100, b);
+		}
+		if (!slow[13] && Selected(only, "simulate_planet_base"))
+		{
+			const SimBase base(state.pw.Fleets(), p);
+			SimBase::Scope bind(&base, state.pw.Fleets());
+			SimulateBench b(state, 100, SimulateBench::PLANET);
+			ColdBench cold(b);
+			slow[13] = Measure("simulate_planet_base", p, f, 100, cold) >= MAX_TIME_PER_CALL;
+		}
+		if (!slow[9] && Selected(only, "simulate_score"))
+		{
+			SimulateBench b(state, 100, SimulateBench::SCORE);
+			ColdBench cold(b);
+			slow[9] = Measure("simulate_score", p, f, 100, cold) >= MAX_TIME_PER_CALL;
+			Warm(b, 1);
+			Measure("simulate_score_hit", p, f, 100, b);
+		}
+		if (!slow[3] && Selected(only, "map"))
+		{
+			MapBench b(state);
+			slow[3] = Measure("map", p, f, 0, b) >= MAX_TIME_PER_CALL;
+		}
+		if (!slow[4] && Selected(only, "map_query"))
+		{
+			Map map(state.pw.Planets());
+			MapQueryBench b(state, map);
+			slow[4] = Measure("map_query", p, f, 0, b) >= MAX_TIME_PER_CALL;
+		}
+		if (!slow[5] && Selected(only, "hub"))
+		{
+			HubBench b(state);
+			slow[5] = Measure("hub", p, f, 0, b) >= MAX_TIME_PER_CALL;
+		}
+		if (!slow[10] && Selected(only, "hub_path"))
+		{
+			PathBench b(state);
+			slow[10] = Measure("hub_path", p, f, 0, b) >= MAX_TIME_PER_CALL;
+		}
+		if (!slow[6] && Selected(only, "strength"))
+		{
+			StrengthBench b(state);
+			slow[6] = Measure("strength", p, f, 20, b) >= MAX_TIME_PER_CALL;
+		}
+		if (!slow[11] && Selected(only, "weakest_scan"))
+		{
+			WeakestBench b(state, false);
+			slow[11] = Measure("weakest_scan", p, f, 0, b) >= MAX_TIME_PER_CALL;
+		}
+		if (!slow[12] && Selected(only, "weakest"))
+		{
+			WeakestBench b(state, true);
+			slow[12] = Measure("weakest", p, f, 0, b) >= MAX_TIME_PER_CALL;
+		}
+		if (!slow[7] && Selected(only, "doturn"))
+		{
+			DoTurnBench b(state);
+			ColdBench cold(b);
+			std::cout.rdbuf(&null);
+			slow[7] = Measure("doturn", p, f, turn, cold) >= MAX_TIME_PER_CALL;
+			Warm(b, 1);
+			Measure("doturn_hit", p, f, turn, b);
+			std::cout.rdbuf(out);
+		}
+	}
+
+	// the simulator over its horizon and the number of fleets on a fixed map
+	if (Selected(only, "simulate_horizon"))
+	{
+		const Scenario scenario(101, 101, seed);
+		State state(scenario);
+		const int horizons[] = {1, 10, 50, 100, 200};
+		for (unsigned int k = 0; k < sizeof(horizons)/sizeof(horizons[0]); k++)
+		{
+			SimulateBench b(state, horizons[k]);
+			Measure("simulate_horizon", scenario.NumPlanets(), scenario.NumFleets(), horizons[k], b);
+		}
+	}
+	if (Selected(only, "simulate_fleets"))
+	{
+		const int fleets[] = {0, 50, 100, 500, 1000, 5000};
+		for (unsigned int k = 0; k < sizeof(fleets)/sizeof(fleets[0]); k++)
+		{
+			const Scenario scenario(101, fleets[k], seed);
+			State state(scenario);
+			SimulateBench b(state, 100);
+			Measure("simulate_fleets", scenario.NumPlanets(), scenario.NumFleets(), 100, b);
+		}
+	}
+
+	// the playouts over the size of the pool, up to twice the cores
+	if (Selected(only, "mcts_threads"))
+	{
+		const Scenario scenario(101, 101, seed);
+		State state(scenario);
+		for (int threads = 1; threads <= 2*ThreadPool::NumCores() && threads <= 64; threads *= 2)
+			MeasurePlayouts(state, threads);
+	}
+
+	// the knapsack over the number of candidates, with the ships to spare of
+	// a strong planet as capacity
+	if (Selected(only, "knapsack"))
+	{
+		for (int items = 10; items <= maxPlanets; items *= 2)
+		{
+			KnapSackBench b(items, 500, seed);
+			if (Measure("knapsack", 0, 0, items, b) >= MAX_TIME_PER_CALL)
+				break;
+		}
+	}
+
+	if (gPool != NULL)
+		delete gPool;
+	return 0;
+}
@@ -0,0 +1,94 @@
+#include "Bot.h"
+#include "Arena.h"
+
+// from MyBot.cc
+void DoTurn(PlanetWars& pw, Timer& timer, FleetVec& orders);
+void ThinkAhead(PlanetVec& AP, FleetVec& AF, const Ponder& ponder);
+extern __thread ThreadPool* gPool;
+extern __thread int         turn;
+extern __thread bool        SEARCH;
+extern __thread bool        MONTE_CARLO;
+extern __thread bool        ENDGAME;
+
+Bot::Bot(int threads, bool s, bool m, bool p, bool e):
+	turn(0),
+	search(s),
+	mcts(m),
+	endgame(e),
+	pool(NULL),
+	ponder(NULL)
+{
+	if (threads > 1 || mcts)
+		pool = new ThreadPool(threads);
+	if (p)
+		ponder = new Ponder(ThinkAhead, this);
+}
+
+// the thread that played last must not keep pointing at the members
+Bot::~Bot() {
+	delete ponder;
+	delete pool;
+	if (Router::Instance() == &router)
+		Router::SetInstance(NULL);
+	if (PlanCache::Instance() == &plans)
+		PlanCache::SetInstance(NULL);
+	if (MapCache::Instance() == &maps)
+		MapCache::SetInstance(NULL);
+	if (Timeline::Instance() == &timeline)
+		Timeline::SetInstance(NULL);
+}
+
+void Bot::Enter() {
+	::turn      = turn;
+	gPool       = pool;
+	SEARCH      = search;
+	MONTE_CARLO = mcts;
+	ENDGAME     = endgame;
+	Router::SetInstance(&router);
+	PlanCache::SetInstance(&plans);
+	MapCache::SetInstance(&maps);
+	Timeline::SetInstance(&timeline);
+}
+
+void Bot::Play(Timer& timer, FleetVec& orders) {
+	if (ponder != NULL)
+	{
+		ponder->Stop();
+		ponder->BeginTurn(pw.Planets(), pw.Fleets());
+	}
+
+	Enter();
+	DoTurn(pw, timer, orders);
+	for (unsigned int i = 0, n = orders.size(); ponder != NULL && i < n; i++)
+		ponder->Order(orders[i]);
+}
+
+void Bot::EndTurn() {
+	maps.Save(router);
+	turn++;
+	if (ponder != NULL)
+		ponder->Start();
+}
+
+bool Bot::Play(const std::string& state, std::vector<Fleet>& orders) {
+	Timer timer;
+	timer.Tick();
+	if (!pw.Update(state))
+		return false;
+
+	{
+		FleetVec issued;
+		Play(timer, issued);
+		orders.assign(issued.begin(), issued.end());
+	}
+	Arena::Instance()->Reset();
+	EndTurn();
+	return true;
+}
+
+// on the pondering thread
+void Bot::ThinkAhead(void* bot, PlanetVec& AP, FleetVec& AF) {
+	Bot* b = static_cast<Bot*>(bot);
+	b->Enter();
+	::ThinkAhead(AP, AF, *b->ponder);
+}
@@ -0,0 +1,60 @@
+#ifndef BOT_
+#define BOT_
+
+#include "PlanetWars.h"
+#include "Router.h"
+#include "PlanCache.h"
+#include "MapCache.h"
+#include "Timeline.h"
+#include "ThreadPool.h"
+#include "Ponder.h"
+#include "Timer.h"
+
+#include <string>
+#include <vector>
+
+// One game played by the decision code of MyBot.cc, without the standard
+// input and output. The code reads the game from thread locals, a bot sets
+// them to its own state, router and plan cache whenever it plays. So bots
+// on different threads play at the same time, while a single bot is played
+// from one thread at a time.
+class Bot {
+public:
+	// a pool of worker threads when threads > 1 or mcts, ponder thinks
+	// ahead between the turns
+	Bot(int threads = 1, bool search = false, bool mcts = false, bool ponder = false, bool endgame = false);
+	~Bot();
+
+	// the state of the current turn, parsed into by the caller or a Reader
+	PlanetWars& State() { return pw; }
+	int         Turn() const { return turn; }
+
+	// the orders for the current state, which is worked on, the timer was
+	// started when the state arrived
+	void Play(Timer& timer, FleetVec& orders);
+	// the orders are sent, saves what was learned about the map and starts
+	// thinking ahead
+	void EndTurn();
+
+	// Update, Play and EndTurn in one, false when the state does not parse
+	bool Play(const std::string& state, std::vector<Fleet>& orders);
+
+private:
+	PlanetWars  pw;
+	int         turn;
+	bool        search;
+	bool        mcts;
+	bool        endgame;
+	ThreadPool* pool;
+	Ponder*     ponder;
+	Router      router;
+	PlanCache   plans;
+	MapCache    maps;
+	Timeline    timeline;
+
+	void Enter(); // makes this the game played on the calling thread
+
+	static void ThinkAhead(void* bot, PlanetVec& AP, FleetVec& AF);
+};
+
+#endif
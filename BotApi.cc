@@ -0,0 +1,43 @@
+#include "BotApi.h"
+#include "Bot.h"
+#include "MapCache.h"
+
+struct pw_bot {
+	pw_bot(int flags, int threads):
+		bot(threads, (flags & PW_SEARCH) != 0, (flags & PW_MCTS) != 0, false, (flags & PW_ENDGAME) != 0)
+	{}
+
+	Bot                bot;
+	std::vector<Fleet> orders; // kept to save the allocation every turn
+};
+
+pw_bot* pw_bot_create(int flags, int threads) {
+	return new pw_bot(flags, threads);
+}
+
+void pw_bot_destroy(pw_bot* bot) {
+	delete bot;
+}
+
+int pw_bot_turn(pw_bot* bot, const char* state, int length, pw_order* orders, int max_orders) {
+	if (!bot->bot.Play(std::string(state, length), bot->orders))
+		return -1;
+
+	const int n = bot->orders.size();
+	for (int i = 0; i < n && i < max_orders; i++)
+	{
+		const Fleet& f = bot->orders[i];
+		orders[i].source      = f.SourcePlanet();
+		orders[i].destination = f.DestinationPlanet();
+		orders[i].ships       = f.NumShips();
+	}
+	return n;
+}
+
+int pw_bot_turns(const pw_bot* bot) {
+	return bot->bot.Turn();
+}
+
+int pw_cache_open(const char* dir) {
+	return MapCache::Open(dir)? 0: -1;
+}
@@ -0,0 +1,49 @@
+#ifndef BOTAPI_
+#define BOTAPI_
+
+/* C interface of the bot library, libE323.a. Every bot plays one game,
+ * bots may be played on different threads at the same time, a single bot
+ * from one thread at a time. A turn takes the game state in the text
+ * format of the game engine, without the closing "go" line, and returns
+ * the orders in a buffer of the caller. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct pw_bot pw_bot;
+
+typedef struct pw_order {
+	int source;
+	int destination;
+	int ships;
+} pw_order;
+
+enum {
+	PW_SEARCH  = 1, /* refine the greedy orders with Search */
+	PW_MCTS    = 2, /* refine the greedy orders with MCTS */
+	PW_ENDGAME = 4  /* solve small states exactly */
+};
+
+/* threads > 1 gives the bot its own pool of worker threads */
+pw_bot* pw_bot_create(int flags, int threads);
+void    pw_bot_destroy(pw_bot* bot);
+
+/* Plays the next turn on the state of length bytes. Returns the number
+ * of orders, of which at most max_orders are written to orders, or -1
+ * when the state does not parse. */
+int pw_bot_turn(pw_bot* bot, const char* state, int length, pw_order* orders, int max_orders);
+
+/* the turns played */
+int pw_bot_turns(const pw_bot* bot);
+
+/* Keeps the tables of every map played in the directory dir, made when
+ * missing, and reads them in later games on the same map. Call before
+ * any bot plays. Returns -1 when dir can not be used. */
+int pw_cache_open(const char* dir);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,168 @@
+#include "Counters.h"
+#include "ThreadKey.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <sys/resource.h>
+
+#define MAX_SLOTS 64 // threads alive at once, the ones after share the last slot
+
+static const char* names[Counters::NUM_COUNTERS] = {
+	"simulations",
+	"simulated_fleets",
+	"maps",
+	"knapsack_cells",
+	"distances",
+	"orders",
+	"allocations",
+	"allocated_bytes",
+	"simcache_hits",
+	"simcache_misses",
+	"simcache_entries",
+	"projected_planets"
+};
+
+Counters::Slot Counters::slots[MAX_SLOTS];
+__thread Counters::Slot* Counters::slot = NULL;
+long long Counters::totals[NUM_COUNTERS];
+std::vector<Counters::Turn> Counters::turns;
+FILE* Counters::file = NULL;
+long Counters::end = 0;
+
+// no allocation, operator new counts through here. The key releases the
+// slot when the thread exits, a shared slot is not released.
+Counters::Slot* Counters::Register() {
+	static const pthread_key_t key = NewKey(Release);
+	for (int i = 0; i < MAX_SLOTS - 1; i++)
+	{
+		if (__atomic_exchange_n(&slots[i].used, 1, __ATOMIC_ACQUIRE) == 0)
+		{
+			slot = &slots[i];
+			pthread_setspecific(key, slot);
+			return slot;
+		}
+	}
+	slot = &slots[MAX_SLOTS - 1];
+	return slot;
+}
+
+// the counts stay in the slot
+void Counters::Release(void* s) {
+	__atomic_store_n(&static_cast<Slot*>(s)->used, 0, __ATOMIC_RELEASE);
+	slot = NULL;
+}
+
+void Counters::EndTurn(int turn, double time) {
+	Turn t;
+	t.turn = turn;
+	t.time = time;
+	for (int c = 0; c < NUM_COUNTERS; c++)
+	{
+		long long sum = 0;
+		for (int i = 0; i < MAX_SLOTS; i++)
+			sum += __atomic_load_n(&slots[i].values[c], __ATOMIC_RELAXED);
+		t.values[c] = sum - totals[c];
+		totals[c]   = sum;
+	}
+
+	struct rusage usage;
+	t.peakRSS = (getrusage(RUSAGE_SELF, &usage) == 0)? usage.ru_maxrss: 0;
+	turns.push_back(t);
+
+	if (file != NULL)
+	{
+		fseek(file, end, SEEK_SET);
+		fprintf(file, "%s\n", Line(turns.size() - 1).c_str());
+		end = ftell(file);
+		fprintf(file, "%s\n", Line(-1).c_str());
+		fflush(file);
+	}
+}
+
+bool Counters::Open(const char* path) {
+	file = fopen(path, "w");
+	end  = 0;
+	return file != NULL;
+}
+
+std::string Counters::Format(const Turn& t, const char* first) {
+	std::ostringstream line;
+	line << "{" << first << ",\"time_ms\":" << t.time*1000.0 << ",\"peak_rss_kb\":" << t.peakRSS;
+	for (int c = 0; c < NUM_COUNTERS; c++)
+		line << ",\"" << names[c] << "\":" << t.values[c];
+	line << "}";
+	return line.str();
+}
+
+// the summary holds the totals and the peak RSS
+std::string Counters::Line(int i) {
+	if (i >= 0)
+	{
+		std::ostringstream first;
+		first << "\"turn\":" << turns[i].turn;
+		return Format(turns[i], first.str().c_str());
+	}
+
+	Turn sum;
+	sum.turn    = turns.size();
+	sum.time    = 0.0;
+	sum.peakRSS = 0;
+	for (int c = 0; c < NUM_COUNTERS; c++)
+		sum.values[c] = 0;
+	for (unsigned int j = 0, n = turns.size(); j < n; j++)
+	{
+		sum.time   += turns[j].time;
+		sum.peakRSS = std::max(sum.peakRSS, turns[j].peakRSS);
+		for (int c = 0; c < NUM_COUNTERS; c++)
+			sum.values[c] += turns[j].values[c];
+	}
+	std::ostringstream first;
+	first << "\"summary\":true,\"turns\":" << sum.turn;
+	return Format(sum, first.str().c_str());
+}
+
+#ifndef NO_ALLOCATION_COUNTS // the library leaves operator new to the program
+
+// the allocation counts, everything else is left to malloc
+void* operator new(size_t size) {
+	Counters::Add(Counters::ALLOCATIONS);
+	Counters::Add(Counters::ALLOCATED_BYTES, size);
+	void* p = malloc(size == 0? 1: size);
+	if (p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) throw() {
+	Counters::Add(Counters::ALLOCATIONS);
+	Counters::Add(Counters::ALLOCATED_BYTES, size);
+	return malloc(size == 0? 1: size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& nt) throw() {
+	return operator new(size, nt);
+}
+
+void operator delete(void* p) throw() {
+	free(p);
+}
+
+void operator delete[](void* p) throw() {
+	free(p);
+}
+
+void operator delete(void* p, size_t) throw() {
+	free(p);
+}
+
+void operator delete[](void* p, size_t) throw() {
+	free(p);
+}
+
+#endif
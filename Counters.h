@@ -0,0 +1,72 @@
+#ifndef COUNTERS_
+#define COUNTERS_
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Counts of the work done on the hot paths, in all builds. Every thread adds
+// to a slot of its own, which the next thread gets when it exits, EndTurn
+// sums the slots and keeps the difference with the previous turn. The adds
+// are atomic, the threads beyond the slots share the last one. With a file open every turn adds a
+// JSON line and the summary line after it is rewritten, so the file is
+// complete when the engine kills the bot at the end of the game.
+// Allocations are counted by the global operator new, which the library
+// does not replace, its allocation counts stay 0.
+class Counters {
+public:
+	enum Counter {
+		SIMULATIONS,
+		SIMULATED_FLEETS,
+		MAPS,
+		KNAPSACK_CELLS,
+		DISTANCES,
+		ORDERS,
+		ALLOCATIONS,
+		ALLOCATED_BYTES,
+		SIM_CACHE_HITS,
+		SIM_CACHE_MISSES,
+		SIM_CACHE_ENTRIES, // slots filled, the size of the memo
+		PROJECTED_PLANETS, // projected to the end of the game again
+		NUM_COUNTERS
+	};
+
+	static void Add(Counter c, long long n = 1) {
+		Slot* s = (slot != NULL)? slot: Register();
+		__atomic_fetch_add(&s->values[c], n, __ATOMIC_RELAXED);
+	}
+
+	// closes the counts of a turn that took time seconds
+	static void EndTurn(int turn, double time);
+
+	static bool Open(const char* path);
+
+	static std::string Line(int i); // of the i-th turn ended, -1 for the summary
+	static int  Turns() { return turns.size(); }
+
+private:
+	struct Slot {
+		long long values[NUM_COUNTERS]; // of all threads that had it
+		int       used;
+	};
+
+	struct Turn {
+		int       turn;
+		double    time;
+		long      peakRSS; // kB
+		long long values[NUM_COUNTERS];
+	};
+
+	static Slot              slots[];
+	static __thread Slot*    slot;
+	static long long         totals[NUM_COUNTERS]; // up to the last turn ended
+	static std::vector<Turn> turns;
+	static FILE*             file;
+	static long              end; // of the last turn line, the summary follows
+
+	static Slot* Register();
+	static void  Release(void* slot);
+	static std::string Format(const Turn&, const char* first);
+};
+
+#endif
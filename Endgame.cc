@@ -0,0 +1,335 @@
+#include "Endgame.h"
+#include "Simulator.h"
+#include "BatchSimulator.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <limits>
+
+#define MAX_MOVES 96 // per player, the joint moves of a turn are the square
+#define MAX_DEPTH 16 // turns left, no deeper search gets to the end in time
+#define MAX_FLEETS 64 // in flight, every leaf simulates them
+#define MAX_CONTESTED 8 // planets with fleets of the other player coming
+#define TT_SIZE   (1<<14)
+#define INF       (std::numeric_limits<int>::max()/2)
+
+Endgame::Endgame(int tl, Timer& t, double dl):
+	turnsLeft(tl),
+	timer(t),
+	deadline(dl),
+	aborted(false),
+	solved(false),
+	depth(0),
+	nodes(0),
+	score(0)
+{
+}
+
+bool Endgame::Small(const PlanetVec& AP, const FleetVec& AF, int turnsLeft) {
+	if (turnsLeft > MAX_DEPTH || AF.size() > MAX_FLEETS)
+		return false;
+
+	// the battles of the fleets in flight widen the range of the scores, the
+	// bounds cut off less of the tree
+	IntVec contested;
+	for (unsigned int i = 0, n = AF.size(); i < n; i++)
+	{
+		const int tid = AF[i].DestinationPlanet();
+		if (AF[i].Owner() != AP[tid].Owner() && find(contested.begin(), contested.end(), tid) == contested.end())
+			contested.push_back(tid);
+	}
+	if (contested.size() > MAX_CONTESTED)
+		return false;
+
+	FleetVec choices;
+	IntVec   begin;
+	const int moves = Choices(AP, 1, turnsLeft, choices, begin);
+	return moves > 1 && moves <= MAX_MOVES && Choices(AP, 2, turnsLeft, choices, begin) <= MAX_MOVES;
+}
+
+bool Endgame::Run(PlanetVec& AP, FleetVec& AF, FleetVec& candidate, FleetVec& best) {
+	Entry empty = {0ULL, -1, 0, EXACT, -1};
+	table.assign(TT_SIZE, empty);
+
+	Search::MoveList moves;
+	moves.push_back(candidate);
+	Generate(AP, 1, turnsLeft, moves);
+
+	int bestMove = -1;
+	for (int d = 1; d <= turnsLeft; d++)
+	{
+		int move = -1;
+		const int value = AlphaBeta(AP, AF, 0, d, -INF, INF, &moves, &move);
+		if (aborted)
+			break;
+
+		bestMove = move;
+		depth    = d;
+		score    = value;
+	}
+
+	solved = depth == turnsLeft;
+	if (!solved)
+		return false;
+
+	best = moves[bestMove];
+	return true;
+}
+
+int Endgame::AlphaBeta(PlanetVec& AP, FleetVec& AF, int ply, int d, int alpha, int beta, Search::MoveList* root, int* bestMove) {
+	nodes++;
+	if (d == 0 || ply >= turnsLeft)
+	{
+		Arena::Scope scope;
+		Simulator sim;
+		return sim.StartScore(turnsLeft - ply, AP, AF);
+	}
+
+	timer.Tock();
+	if (timer.Time() > deadline)
+	{
+		aborted = true;
+		return 0;
+	}
+
+	if (root == NULL)
+	{
+		int lower, upper;
+		Bounds(AP, AF, turnsLeft - ply, lower, upper);
+		if (upper <= alpha)
+			return upper;
+		if (lower >= beta)
+			return lower;
+	}
+
+	const unsigned long long key = Key(AP, AF, turnsLeft - ply);
+	Entry* e = &table[key & (TT_SIZE - 1)];
+	int ttMove = -1;
+	if (e->key == key && e->depth >= 0)
+	{
+		ttMove = e->move;
+		if (root == NULL && e->depth >= d)
+		{
+			if (e->bound == EXACT)
+				return e->value;
+			if (e->bound == LOWER && e->value >= beta)
+				return e->value;
+			if (e->bound == UPPER && e->value <= alpha)
+				return e->value;
+		}
+	}
+
+	Arena::Scope scope;
+	Search::MoveList  local;
+	Search::MoveList& M = (root == NULL)? local: *root;
+	if (root == NULL)
+		Generate(AP, 1, turnsLeft - ply, local);
+	Search::MoveList E;
+	Generate(AP, 2, turnsLeft - ply, E);
+
+	// the best move of the previous iteration goes first
+	IntVec order;
+	if (ttMove >= 0 && ttMove < int(M.size()))
+		order.push_back(ttMove);
+	for (int i = 0, n = M.size(); i < n; i++)
+		if (i != ttMove)
+			order.push_back(i);
+
+	const int alpha0 = alpha;
+	int best    = -INF;
+	int bestIdx = order[0];
+	const bool leaves = d == 1 || ply+1 >= turnsLeft;
+	PlanetVec CAP; FleetVec CAF;
+	for (unsigned int i = 0, n = order.size(); i < n && best < beta; i++)
+	{
+		IntVec scores(leaves? E.size(): 0);
+		if (leaves)
+			EvaluateReplies(AP, AF, M[order[i]], E, ply+1, scores);
+
+		int worst = INF;
+		for (unsigned int j = 0, m = E.size(); j < m; j++)
+		{
+			const int lo = std::max<int>(alpha, best);
+			const int hi = std::min<int>(beta, worst);
+			int v;
+			if (leaves)
+			{
+				nodes++;
+				v = scores[j];
+			}
+			else
+			{
+				CAP = AP;
+				CAF = AF;
+				Search::Apply(CAP, CAF, M[order[i]], 1);
+				Search::Apply(CAP, CAF, E[j], 2);
+				{
+					Arena::Scope advance;
+					Simulator sim;
+					sim.Start(1, CAP, CAF, true, false);
+				}
+
+				v = AlphaBeta(CAP, CAF, ply+1, d-1, lo, hi, NULL, NULL);
+				if (aborted)
+					return 0;
+			}
+
+			worst = std::min<int>(worst, v);
+			if (worst <= lo)
+				break;
+		}
+
+		if (worst > best)
+		{
+			best    = worst;
+			bestIdx = order[i];
+		}
+	}
+
+	e->key   = key;
+	e->depth = d;
+	e->value = best;
+	e->move  = bestIdx;
+	if (best <= alpha0)
+		e->bound = UPPER;
+	else
+	if (best >= beta)
+		e->bound = LOWER;
+	else
+		e->bound = EXACT;
+
+	if (bestMove != NULL)
+		*bestMove = bestIdx;
+
+	return best;
+}
+
+// the scores after our move, each of the replies and the rest of the game
+void Endgame::EvaluateReplies(PlanetVec& AP, FleetVec& AF, const FleetVec& move, Search::MoveList& E, int ply, IntVec& scores) {
+	Arena::Scope scope;
+	PlanetVec CAP(AP);
+	FleetVec  CAF(AF);
+	Search::Apply(CAP, CAF, move, 1);
+	BatchSimulator batch(CAP, CAF);
+	for (unsigned int j = 0, m = E.size(); j < m; j++)
+		batch.Launch(batch.AddScenario(), E[j], 2);
+
+	batch.Run(1 + turnsLeft - ply);
+	for (unsigned int j = 0, m = E.size(); j < m; j++)
+		scores[j] = batch.GetScore(j);
+}
+
+// A fight between the players costs both the same ships, so in the turns
+// left the score only moves by the growth, at most all of it for one side,
+// and by the neutral ships the players lose taking planets.
+void Endgame::Bounds(const PlanetVec& AP, const FleetVec& AF, int turns, int& lower, int& upper) const {
+	int now = 0, neutral = 0, growth = 0;
+	for (unsigned int i = 0, n = AP.size(); i < n; i++)
+	{
+		const Planet& p = AP[i];
+		growth += p.GrowthRate();
+		switch (p.Owner())
+		{
+			case 0:  neutral += p.NumShips(); break;
+			case 1:  now += p.NumShips(); break;
+			default: now -= p.NumShips(); break;
+		}
+	}
+	for (unsigned int i = 0, n = AF.size(); i < n; i++)
+		now += (AF[i].Owner() == 1)? AF[i].NumShips(): -AF[i].NumShips();
+
+	lower = now - neutral - growth*turns;
+	upper = now + neutral + growth*turns;
+}
+
+// FNV-1a over the planets, the fleets are summed as in Search::Hash
+unsigned long long Endgame::Key(const PlanetVec& AP, const FleetVec& AF, int horizon) {
+	#define MIX(h, v) (((h) ^ (unsigned long long)(v)) * 1099511628211ULL)
+	unsigned long long h = MIX(14695981039346656037ULL, horizon);
+	for (unsigned int i = 0, n = AP.size(); i < n; i++)
+	{
+		h = MIX(h, AP[i].Owner());
+		h = MIX(h, AP[i].NumShips());
+	}
+
+	unsigned long long fh = 0;
+	for (unsigned int i = 0, n = AF.size(); i < n; i++)
+	{
+		const Fleet& f = AF[i];
+		unsigned long long k = 14695981039346656037ULL;
+		k = MIX(k, f.Owner());
+		k = MIX(k, f.NumShips());
+		k = MIX(k, f.DestinationPlanet());
+		k = MIX(k, f.TurnsRemaining());
+		fh += k;
+	}
+	return MIX(h, fh);
+	#undef MIX
+}
+
+int Endgame::Choices(const PlanetVec& AP, int owner, int turnsLeft, FleetVec& choices, IntVec& begin) {
+	choices.clear();
+	begin.clear();
+	int moves = 1;
+	for (unsigned int i = 0, n = AP.size(); i < n && moves <= MAX_MOVES; i++)
+	{
+		const Planet& source = AP[i];
+		if (source.Owner() != owner || source.NumShips() <= 0)
+			continue;
+
+		begin.push_back(choices.size());
+		for (unsigned int j = 0; j < n; j++)
+		{
+			const Planet& target = AP[j];
+			const int dist = source.Distance(target);
+			if (j == i || dist > turnsLeft)
+				continue;
+
+			const int all = source.NumShips();
+			choices.push_back(Fleet(owner, all, i, j, dist, dist));
+			if (target.Owner() == owner)
+				continue;
+
+			const int need = target.NumShips() + ((target.Owner() == 0)? 0: dist*target.GrowthRate()) + 1;
+			if (need < all)
+				choices.push_back(Fleet(owner, need, i, j, dist, dist));
+		}
+		moves *= 1 + choices.size() - begin.back();
+	}
+	begin.push_back(choices.size());
+	return std::min(moves, MAX_MOVES + 1);
+}
+
+// every combination of the choices, the pass first. A state that grew too
+// large further down the search keeps the first MAX_MOVES.
+void Endgame::Generate(const PlanetVec& AP, int owner, int turnsLeft, Search::MoveList& moves) {
+	FleetVec choices;
+	IntVec   begin;
+	Choices(AP, owner, turnsLeft, choices, begin);
+
+	// digit k is the choice of the k-th planet, where its count means keep
+	const int sources = begin.size() - 1;
+	IntVec digit(sources, 0);
+	for (int k = 0; k < sources; k++)
+		digit[k] = begin[k+1] - begin[k];
+
+	FleetVec orders;
+	for (int count = 0; count < MAX_MOVES; count++)
+	{
+		orders.clear();
+		for (int k = 0; k < sources; k++)
+			if (begin[k] + digit[k] < begin[k+1])
+				orders.push_back(choices[begin[k] + digit[k]]);
+		moves.push_back(orders);
+
+		int k = 0;
+		while (k < sources && digit[k] == 0)
+		{
+			digit[k] = begin[k+1] - begin[k];
+			k++;
+		}
+		if (k == sources)
+			break;
+		digit[k]--;
+	}
+}
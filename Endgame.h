@@ -0,0 +1,84 @@
+#ifndef ENDGAME_
+#define ENDGAME_
+
+#include "PlanetWars.h"
+#include "Search.h"
+#include "Timer.h"
+
+// Exhaustive search for small states. The move of a player is one choice
+// per planet with ships: keep them, or send to a planet reached before the
+// game ends either all of them or the ships that take it on arrival. All
+// combinations are searched, up to MAX_MOVES of them in states that grow
+// during the search. Each turn both sides move, the enemy replying
+// knowing our move as in Search, and the state is advanced with the
+// Simulator. Iterative deepening alpha-beta with a transposition table,
+// the leaves are scored with the Simulator up to the end of the game. A
+// node is cut off when the bounds on its score, what the growth and the
+// neutral ships can still change, lie outside the window. An iteration
+// that reaches the end of the game gives the exact minimax value over
+// these moves only: all ships, just enough ships or keep, per planet. Other
+// splits of the ships are never tried, so a solved state is optimal over
+// the restricted move set, not over every order of the game.
+class Endgame {
+public:
+	Endgame(int turnsLeft, Timer& timer, double deadline);
+
+	// true when the game ends within MAX_DEPTH turns, neither player has
+	// more than MAX_MOVES moves, at most MAX_FLEETS fleets are in flight and
+	// at most MAX_CONTESTED planets are attacked by the fleets
+	static bool Small(const PlanetVec& AP, const FleetVec& AF, int turnsLeft);
+
+	// Searches the state for player 1 until it is solved or the deadline
+	// passes. The candidate is tried first at the root. Returns false when
+	// the search did not get to the end of the game, in which case best is
+	// left untouched.
+	bool Run(PlanetVec& AP, FleetVec& AF, FleetVec& candidate, FleetVec& best);
+
+	int  Depth() const  { return depth; }  // deepest completed iteration
+	int  Nodes() const  { return nodes; }
+	int  Score() const  { return score; }  // score of the best move
+	bool Solved() const { return solved; } // searched up to the end of the game
+
+private:
+	enum Bound {
+		EXACT,
+		LOWER,
+		UPPER
+	};
+
+	struct Entry {
+		unsigned long long key; // the full key, the low bits pick the slot
+		int depth;
+		int value;
+		int bound;
+		int move;
+	};
+
+	typedef std::vector<Entry, ArenaAllocator<Entry> > Table;
+
+	int    turnsLeft;
+	Timer& timer;
+	double deadline;
+	bool   aborted;
+	bool   solved;
+	int    depth;
+	int    nodes;
+	int    score;
+	Table  table; // private to the search, so games on other threads do not share it
+
+	int  AlphaBeta(PlanetVec&, FleetVec&, int ply, int depth, int alpha, int beta, Search::MoveList* root, int* bestMove);
+	void EvaluateReplies(PlanetVec&, FleetVec&, const FleetVec& move, Search::MoveList& E, int ply, IntVec& scores);
+	void Bounds(const PlanetVec&, const FleetVec&, int turns, int& lower, int& upper) const;
+
+	// 64 bit key of the state, two states sharing a slot and the 32 bit
+	// Search::Hash would otherwise take each others values
+	static unsigned long long Key(const PlanetVec&, const FleetVec&, int horizon);
+
+	// the choices of the planets of owner with ships, the k-th of them sends
+	// one of choices[begin[k], begin[k+1]) or keeps its ships. Returns the
+	// number of moves, counted up to MAX_MOVES+1.
+	static int  Choices(const PlanetVec&, int owner, int turnsLeft, FleetVec& choices, IntVec& begin);
+	static void Generate(const PlanetVec&, int owner, int turnsLeft, Search::MoveList& moves);
+};
+
+#endif
@@ -0,0 +1,164 @@
+#include "FlightRecorder.h"
+
+#include <cstring>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+#define RING_SIZE (1<<16) // entries, roughly the last 100 turns of a busy game
+#define PATH_SIZE 256
+
+FlightRecorder::Entry FlightRecorder::ring[RING_SIZE];
+unsigned int FlightRecorder::head = 0;
+char FlightRecorder::path[PATH_SIZE] = "crash.txt";
+pthread_t FlightRecorder::owner;
+
+void FlightRecorder::Install(const char* p) {
+	strncpy(path, p, PATH_SIZE-1);
+	owner = pthread_self();
+
+	// the first backtrace() loads libgcc, which allocates, do it now
+	void* addresses[1];
+	backtrace(addresses, 1);
+
+	const int signals[] = {SIGSEGV, SIGABRT, SIGFPE, SIGBUS, SIGILL};
+	for (unsigned int i = 0; i < sizeof(signals)/sizeof(signals[0]); i++)
+		signal(signals[i], Crash);
+}
+
+void FlightRecorder::Add(const Entry& e) {
+	if (!pthread_equal(pthread_self(), owner))
+		return;
+
+	ring[head & (RING_SIZE - 1)] = e;
+	head++;
+}
+
+void FlightRecorder::BeginTurn(int turn, const PlanetVec& AP, const FleetVec& AF) {
+	Entry t = {TURN, 0, 0, 0, 0, turn, NULL};
+	Add(t);
+	for (unsigned int i = 0, n = AP.size(); i < n; i++)
+	{
+		const Planet& p = AP[i];
+		Entry e = {PLANET, (unsigned char)p.Owner(), (unsigned short)i, 0, 0, p.NumShips(), NULL};
+		Add(e);
+	}
+	for (unsigned int i = 0, n = AF.size(); i < n; i++)
+	{
+		const Fleet& f = AF[i];
+		Entry e = {FLEET, (unsigned char)f.Owner(), (unsigned short)f.SourcePlanet(),
+			(unsigned short)f.DestinationPlanet(), (unsigned short)f.TurnsRemaining(), f.NumShips(), NULL};
+		Add(e);
+	}
+}
+
+void FlightRecorder::Phase(const char* name) {
+	Entry e = {PHASE, 0, 0, 0, 0, 0, name};
+	Add(e);
+}
+
+void FlightRecorder::Order(const Fleet& order) {
+	Entry e = {ORDER, 1, (unsigned short)order.SourcePlanet(),
+		(unsigned short)order.DestinationPlanet(), 0, order.NumShips(), NULL};
+	Add(e);
+}
+
+// minimal buffered output for the signal handler
+struct Out {
+	int  fd;
+	int  n;
+	char buf[4096];
+
+	void Flush() {
+		for (int done = 0; done < n;)
+		{
+			const ssize_t w = write(fd, buf + done, n - done);
+			if (w <= 0)
+				break;
+			done += w;
+		}
+		n = 0;
+	}
+
+	void Put(const char* s) {
+		for (; *s != '\0'; s++)
+		{
+			if (n == int(sizeof(buf)))
+				Flush();
+			buf[n++] = *s;
+		}
+	}
+
+	void Put(int v) {
+		char digits[16];
+		int i = sizeof(digits) - 1;
+		const bool negative = v < 0;
+		unsigned int u = negative? -(unsigned int)v: v;
+		digits[i] = '\0';
+		do
+		{
+			digits[--i] = '0' + u % 10;
+			u /= 10;
+		} while (u > 0);
+		if (negative)
+			digits[--i] = '-';
+		Put(&digits[i]);
+	}
+};
+
+// one line per planet (id owner ships) and fleet (owner ships source
+// destination turns), turns, phases and orders as comment lines
+void FlightRecorder::Dump() {
+	static Out out;
+	out.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	out.n  = 0;
+	if (out.fd == -1)
+		return;
+
+	// skip the partly overwritten oldest turn
+	const unsigned int end = head;
+	unsigned int i = (end > RING_SIZE)? end - RING_SIZE: 0;
+	while (i < end && ring[i & (RING_SIZE - 1)].type != TURN)
+		i++;
+
+	for (; i < end; i++)
+	{
+		const Entry& e = ring[i & (RING_SIZE - 1)];
+		switch (e.type)
+		{
+			case TURN:
+				out.Put("# turn "); out.Put(e.ships); out.Put("\n");
+				break;
+			case PLANET:
+				out.Put("P "); out.Put(e.a); out.Put(" "); out.Put(e.owner);
+				out.Put(" "); out.Put(e.ships); out.Put("\n");
+				break;
+			case FLEET:
+				out.Put("F "); out.Put(e.owner); out.Put(" "); out.Put(e.ships);
+				out.Put(" "); out.Put(e.a); out.Put(" "); out.Put(e.b);
+				out.Put(" "); out.Put(e.c); out.Put("\n");
+				break;
+			case PHASE:
+				out.Put("# phase "); out.Put(e.name); out.Put("\n");
+				break;
+			case ORDER:
+				out.Put("# order "); out.Put(e.a); out.Put(" "); out.Put(e.b);
+				out.Put(" "); out.Put(e.ships); out.Put("\n");
+				break;
+		}
+	}
+
+	out.Put("# backtrace\n");
+	out.Flush();
+	void* addresses[32];
+	const int size = backtrace(addresses, 32);
+	backtrace_symbols_fd(addresses, size, out.fd);
+	close(out.fd);
+}
+
+void FlightRecorder::Crash(int signum) {
+	Dump();
+	signal(signum, SIG_DFL);
+	kill(getpid(), signum);
+}
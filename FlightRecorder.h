@@ -0,0 +1,62 @@
+#ifndef FLIGHTRECORDER_
+#define FLIGHTRECORDER_
+
+#include "PlanetWars.h"
+#include "Logger.h"
+
+#include <pthread.h>
+
+// Always on record of the last turns: the parsed state, the DoTurn phases
+// and the orders, kept in a preallocated ring of fixed size entries so the
+// oldest turns are overwritten. Only the thread that installed it records,
+// the phases of the pondering thread are left out. On a crash the signal
+// handler writes the ring out with write(2) and nothing else, no
+// allocation, no stdio.
+class FlightRecorder {
+public:
+	// installs the crash handlers, the dump goes to path
+	static void Install(const char* path);
+
+	static void BeginTurn(int turn, const PlanetVec& AP, const FleetVec& AF);
+	static void Phase(const char* name); // name must be a string literal
+	static void Order(const Fleet& order);
+
+	// async signal safe
+	static void Dump();
+
+private:
+	enum Type {
+		TURN,
+		PLANET,
+		FLEET,
+		PHASE,
+		ORDER
+	};
+
+	struct Entry {
+		unsigned char  type;
+		unsigned char  owner;
+		unsigned short a;     // planet or source
+		unsigned short b;     // destination
+		unsigned short c;     // fleet turns remaining
+		int            ships; // or the turn
+		const char*    name;
+	};
+
+	static Entry        ring[];
+	static unsigned int head; // entries ever added
+	static char         path[];
+	static pthread_t    owner; // the thread that installed it
+
+	static void Add(const Entry&);
+	static void Crash(int signum);
+};
+
+// marks a DoTurn phase in the log and the flight recorder
+#define PHASE(name)                      \
+	do {                                 \
+		LOG(name);                       \
+		FlightRecorder::Phase(name);     \
+	} while (0)
+
+#endif
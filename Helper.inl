@@ -1,6 +1,7 @@
-const std::vector<Planet>* gAP     = NULL;
-const std::vector<Fleet>*  gAF     = NULL;
-int                        gTarget = 0;
+// thread local, the helpers may be used by worker threads
+__thread const PlanetVec* gAP     = NULL;
+__thread const FleetVec*  gAF     = NULL;
+__thread int              gTarget = 0;
 
 inline bool SortOnGrowthRateAndOwner(const int pidA, const int pidB) {
 	const Planet& a = gAP->at(pidA);
@@ -36,7 +37,7 @@ inline bool SortOnPlanetAndTurnsLeft(const Fleet& a, const Fleet& b) {
 		return a.DestinationPlanet() < b.DestinationPlanet();
 }
 
-void Erase(std::vector<int>& subject, std::vector<int>& eraser) {
+void Erase(IntVec& subject, IntVec& eraser) {
 	ASSERT(subject.size() >= eraser.size());
 	sort(eraser.begin(), eraser.end());
 
@@ -57,13 +58,13 @@ struct NPV {
 };
 
 // Determine the "goodness" of a neutral planet
-double GetValue(Planet& p, int dist) {
+double GetValue(const Planet& p, int dist) {
 	#define EPS 1.0e-10
 	return pow(p.GrowthRate(), 2.0) / (p.NumShips() * dist + EPS);
 }
 
 // Get the incomming fleets of a certain planet
-int GetIncommingFleets(const int sid, std::vector<int>& FIDX, int remaining = 1000) {
+int GetIncommingFleets(const int sid, IntVec& FIDX, int remaining = 1000) {
 	int numFleets = 0;
 	for (unsigned int j = 0, m = FIDX.size(); j < m; j++)
 	{
@@ -77,7 +78,7 @@ int GetIncommingFleets(const int sid, std::vector<int>& FIDX, int remaining = 10
 }
 
 // Compute the potential strength if all planets in the neighbourhood will feed this planet
-int GetStrength(const int tid, const int dist, std::vector<int>& PIDX, std::vector<int>& FIDX) {
+int GetStrength(const int tid, const int dist, IntVec& PIDX, IntVec& FIDX) {
 	int strength = 0;
 	const Planet& target = gAP->at(tid);
 	for (unsigned int i = 0, n = PIDX.size(); i < n; i++)
@@ -93,39 +94,3 @@ int GetStrength(const int tid, const int dist, std::vector<int>& PIDX, std::vect
 	}
 	return strength;
 }
-
-// Determine the closest-to-source in between lying hub for rerouting
-int GetHub(const int sid, const int tid) {
-	#define BETWEEN(v, a, b) ((v > a && v < b) || (v < a && v > b))
-	static const double MAX_DETOUR = 1.0;
-
-	int hid = tid;
-	const Planet& source = gAP->at(sid);
-	const Planet& target = gAP->at(tid);
-	vec3<double> vecTarget = target.Loc() - source.Loc();
-	double distance = vecTarget.len2D();
-	double s2t = distance;
-	for (unsigned int i = 0, n = gAP->size(); i < n; i++)
-	{
-		const Planet& hub = gAP->at(i);
-		if (hub.Owner() == source.Owner() && hub.PlanetID() != tid && hub.PlanetID() != sid)
-		{
-			vec3<double> vecHub = hub.Loc() - source.Loc();
-			vec3<double> vecProjectHub = vecHub.project(vecTarget);
-			if (BETWEEN(vecProjectHub.x, 0.0, vecTarget.x) && BETWEEN(vecProjectHub.z, 0.0, vecTarget.z))
-			{
-				const double s2h = vecHub.len2D();
-				const double h2t = (hub.Loc() - target.Loc()).len2D();
-				const double pLength = vecProjectHub.len2D();
-				const double detour  = (s2h + h2t) - s2t;
-				if (pLength < distance && detour <= MAX_DETOUR)
-				{
-					hid = hub.PlanetID();
-					distance = pLength;
-				}
-			}
-		}
-	}
-	return hid;
-}
-
@@ -1,13 +1,14 @@
 #include "KnapSack.h"
 #include "Logger.h"
+#include "Counters.h"
 
 #define IDX(i,j) ((i)*(W+1)+(j))
 
-KnapSack::KnapSack(std::vector<int>& w_, std::vector<double>& v_, int W_) {
+KnapSack::KnapSack(IntVec& w_, DoubleVec& v_, int W_) {
 	Init(w_, v_, W_);
 }
 
-void KnapSack::Init(std::vector<int>& w_, std::vector<double>& v_, int W_) {
+void KnapSack::Init(IntVec& w_, DoubleVec& v_, int W_) {
 	w = w_;
 	v = v_;
 	W = W_;
@@ -28,7 +29,7 @@ void KnapSack::Init(std::vector<int>& w_, std::vector<double>& v_, int W_) {
 	I.clear();
 }
 
-std::vector<int>& KnapSack::Indices() {
+IntVec& KnapSack::Indices() {
 	ASSERT(!v.empty() && !w.empty());
 	if (!I.empty())
 	{
@@ -67,6 +68,7 @@ double KnapSack::ZeroOne(int n, int c) {
 				val = temp;
 		}
 		C[IDX(n, c)] = val;
+		Counters::Add(Counters::KNAPSACK_CELLS);
 	}
 	return C[IDX(n, c)];
 }
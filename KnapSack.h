@@ -1,18 +1,20 @@
+#include "Arena.h"
+
 #include <vector>
 
 class KnapSack {
 public:
-	KnapSack(std::vector<int>&, std::vector<double>&, int);
-	std::vector<int>& Indices();
-	void Init(std::vector<int>&, std::vector<double>&, int);
+	KnapSack(IntVec&, DoubleVec&, int);
+	IntVec& Indices();
+	void Init(IntVec&, DoubleVec&, int);
 
 private:
-	std::vector<int>    w; // w_0,...,w_n
-	std::vector<double> v; // v_0,...,v_n
-	int W;                 // Knapsack capacity
-	int N;                 // Total amount of items
-	std::vector<double> C; // Cost matrix
-	std::vector<int>    I; // Solution indices
+	IntVec    w; // w_0,...,w_n
+	DoubleVec v; // v_0,...,v_n
+	int       W; // Knapsack capacity
+	int       N; // Total amount of items
+	DoubleVec C; // Cost matrix
+	IntVec    I; // Solution indices
 
 	double ZeroOne(int, int);
 };
@@ -1,12 +1,20 @@
 #include <ctime>
 #include <iostream>
 #include <sstream>
+#include <unistd.h>
 
 #include "./Logger.h"
 
-Logger* Logger::instance = NULL;
+Logger* volatile Logger::instance = NULL;
 
-Logger::Logger(std::string n = "") {
+Logger::Logger(std::string n = "", bool a):
+	level(LOG_DEBUG),
+	async(a),
+	head(0),
+	tail(0),
+	dropped(0),
+	quit(false)
+{
 	isGood = false;
 	if (n.empty())
 		name = GetLogName();
@@ -14,6 +22,25 @@ Logger::Logger(std::string n = "") {
 		name = n;
 	log.open(name.c_str());
 	isGood = log.good();
+
+	// a cell is free for the producer of sequence number i when it holds i,
+	// and ready for the writer when it holds i+1
+	for (unsigned int i = 0; i < RING_SIZE; i++) {
+		ring[i].sequence = i;
+		ring[i].record   = NULL;
+	}
+
+	if (isGood && async)
+		async = pthread_create(&writer, NULL, Main, this) == 0;
+}
+
+Logger::~Logger() {
+	if (isGood && async) {
+		__atomic_store_n(&quit, true, __ATOMIC_RELEASE);
+		pthread_join(writer, NULL);
+	}
+	log.flush();
+	log.close();
 }
 
 std::string Logger::GetLogName() {
@@ -40,3 +67,90 @@ std::string Logger::GetLogName() {
 
 	return (std::string(buf));
 }
+
+void Logger::Write(const std::string& s) {
+	if (!async) {
+		log << s;
+		log.flush();
+		return;
+	}
+
+	std::string* record = new std::string(s);
+	if (!Push(record)) {
+		__sync_fetch_and_add(&dropped, 1);
+		delete record;
+	}
+}
+
+void Logger::Flush() {
+	if (!isGood || !async)
+		return;
+
+	const unsigned int target = __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+	while (int(__atomic_load_n(&tail, __ATOMIC_ACQUIRE) - target) < 0)
+		usleep(100);
+}
+
+// bounded multi producer queue, a producer claims a sequence number with a
+// compare and swap and publishes the record by advancing the cell sequence
+bool Logger::Push(std::string* record) {
+	unsigned int pos = __atomic_load_n(&head, __ATOMIC_RELAXED);
+	Cell* cell;
+	while (true) {
+		cell = &ring[pos & (RING_SIZE - 1)];
+		const int dif = int(__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) - pos);
+		if (dif == 0) {
+			if (__sync_bool_compare_and_swap(&head, pos, pos + 1))
+				break;
+			pos = __atomic_load_n(&head, __ATOMIC_RELAXED);
+		}
+		else
+		if (dif < 0) {
+			return false; // full, the writer did not free this cell yet
+		}
+		else {
+			pos = __atomic_load_n(&head, __ATOMIC_RELAXED);
+		}
+	}
+	cell->record = record;
+	__atomic_store_n(&cell->sequence, pos + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+// writes the ready records, returns false when there were none
+bool Logger::Drain() {
+	bool any = false;
+	while (true) {
+		Cell* cell = &ring[tail & (RING_SIZE - 1)];
+		if (int(__atomic_load_n(&cell->sequence, __ATOMIC_ACQUIRE) - (tail + 1)) < 0)
+			break;
+
+		log << *cell->record;
+		delete cell->record;
+		cell->record = NULL;
+		__atomic_store_n(&cell->sequence, tail + RING_SIZE, __ATOMIC_RELEASE);
+		__atomic_store_n(&tail, tail + 1, __ATOMIC_RELEASE);
+		any = true;
+	}
+
+	if (any) {
+		const unsigned int n = __sync_lock_test_and_set(&dropped, 0);
+		if (n > 0)
+			log << "*** " << n << " log records dropped ***\n";
+		log.flush();
+	}
+	return any;
+}
+
+void* Logger::Main(void* arg) {
+	Logger* logger = static_cast<Logger*>(arg);
+	while (true) {
+		const bool stop = __atomic_load_n(&logger->quit, __ATOMIC_ACQUIRE);
+		if (!logger->Drain()) {
+			if (stop)
+				break;
+			usleep(1000);
+		}
+	}
+	return NULL;
+}
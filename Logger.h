@@ -7,24 +7,32 @@
 #include <cstdio>
 #include <cstdlib>
 #include <execinfo.h>
+#include <pthread.h>
 
 enum LogLevel {
 	LOG_BASIC,
 	LOG_DEBUG,
 };
 
+// levels above this are compiled out
+#ifndef LOG_LEVEL_MAX
+#define LOG_LEVEL_MAX LOG_DEBUG
+#endif
+
+// Records are handed to a background writer thread through a bounded lock
+// free ring, any thread may log. When the ring is full the record is
+// dropped instead of stalling the turn, the writer reports the drops.
 class Logger {
 	public:
-		Logger(std::string);
-
-		~Logger() {
-			log.flush();
-			log.close();
-		}
+		Logger(std::string, bool async = true);
+		~Logger();
 
 		static Logger* Instance() {
-			if (instance == NULL)
-				instance = new Logger("");
+			if (instance == NULL) {
+				Logger* logger = new Logger("");
+				if (!__sync_bool_compare_and_swap(&instance, NULL, logger))
+					delete logger;
+			}
 			return instance;
 		}
 
@@ -39,51 +47,81 @@ class Logger {
 
 		std::string GetLogName();
 
+		void     SetLevel(LogLevel lvl) { level = lvl; }
+		LogLevel GetLevel() const       { return level; }
+		bool     Enabled(LogLevel lvl) const { return isGood && lvl <= level; }
+
+		void     Flush(); // blocks until the writer has written all records
+		unsigned Dropped() const { return dropped; }
+
 		Logger& operator << (const char* s) {
 			if (isGood) {
-				log << s;
+				Write(s);
 			}
 			return *this;
 		}
 		template<typename T> Logger& operator << (const T& t) {
 			if (isGood) {
-				log << t;
+				std::ostringstream ss;
+				ss << t;
+				Write(ss.str());
 			}
 			return *this;
 		}
 
 		template<typename T> Logger& Log(const T& t, LogLevel lvl = LOG_BASIC) {
-			if (isGood) {
-				switch (lvl) {
-					case LOG_BASIC: {
-						log << t; log << std::endl;
-					} break;
-					case LOG_DEBUG: {
-						/* TODO */
-					} break;
-					default: {
-					} break;
-				}
+			if (Enabled(lvl)) {
+				std::ostringstream ss;
+				ss << t << '\n';
+				Write(ss.str());
 			}
 			return *this;
 		}
 
 	private:
-		static Logger* instance;
+		enum { RING_SIZE = 1<<12 };
+
+		struct Cell {
+			volatile unsigned int sequence;
+			std::string*          record;
+		};
+
+		static Logger* volatile instance;
 		std::string dir;
 		std::string name;
 		std::ofstream log;
 		bool isGood;
+		volatile LogLevel level;
+
+		bool          async;
+		Cell          ring[RING_SIZE];
+		volatile unsigned int head;    // next cell to fill, shared by the producers
+		char          pad[60];         // keep the producers off the writers cache line
+		volatile unsigned int tail;    // next cell to write, owned by the writer
+		volatile unsigned int dropped;
+		volatile bool quit;
+		pthread_t     writer;
+
+		void  Write(const std::string&);
+		bool  Push(std::string*);
+		bool  Drain();
+		static void* Main(void*);
 };
 
 #ifdef DEBUG
-#define LOG(msg)                              \
-	do {                                      \
-		std::stringstream ss;                 \
-		ss << msg;                            \
-		Logger::Instance()->Log(ss.str());    \
+// the message is only formatted when the level is written
+#define LOG_AT(lvl, msg)                                                \
+	do {                                                                \
+		if ((lvl) <= LOG_LEVEL_MAX && Logger::Instance()->Enabled(lvl)) { \
+			std::stringstream ss;                                       \
+			ss << msg;                                                  \
+			Logger::Instance()->Log(ss.str(), lvl);                     \
+		}                                                               \
 	} while(0)
 
+#define LOG(msg)  LOG_AT(LOG_BASIC, msg)
+#define LOGD(msg) LOG_AT(LOG_DEBUG, msg)
+
 #define FORMAT_STRING "***ASSERTION FAILED***\n\n\tfile\t%s\n\tline\t%d\n\tfunc\t%s\n\tcond\t%s\n"
 
 #define ASSERT(cond)                                                              \
@@ -98,6 +136,7 @@ class Logger {
 		if ( !(cond) ) {                                                          \
 			FATAL(FORMAT_STRING, __FILE__, __LINE__, __PRETTY_FUNCTION__, #cond); \
 			LOG(msg);                                                             \
+			Logger::Instance()->Flush();                                          \
 		}                                                                         \
 	} while (0)
 
@@ -117,6 +156,7 @@ class Logger {
 		snprintf(buffer, 2048, __VA_ARGS__); \
 		LOG(buffer);                         \
 		BACKTRACE();                         \
+		Logger::Instance()->Flush();         \
 	} while (0)
 
 #endif // DEBUG
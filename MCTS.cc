@@ -0,0 +1,289 @@
+#include "MCTS.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cmath>
+
+#define BATCH_SIZE    8
+#define ROLLOUT_TURNS 30
+#define NUM_NEAREST   5
+#define VIRTUAL_LOSS  3
+#define UCT_C         0.7
+
+static inline unsigned int Random(unsigned int& x) {
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+MCTS::MCTS(int tl, Timer& t, double dl):
+	turnsLeft(tl),
+	timer(t),
+	deadline(dl),
+	stop(false),
+	playouts(0)
+{
+	root.visits = root.wins = 0;
+}
+
+bool MCTS::Run(ThreadPool& pool, PlanetVec& AP, FleetVec& AF, FleetVec& candidate, FleetVec& best) {
+	M.push_back(candidate);
+	Search::Generate(AP, AF, M);
+	PlanetVec FAP; FleetVec FAF;
+	Search::Flip(AP, AF, FAP, FAF);
+	Search::Generate(FAP, FAF, E);
+
+	const int N = AP.size();
+	for (int i = 0; i < N; i++)
+	{
+		FPlanet p = {AP[i].Owner(), AP[i].NumShips(), AP[i].GrowthRate()};
+		base.push_back(p);
+	}
+	for (unsigned int i = 0, n = AF.size(); i < n; i++)
+	{
+		FFleet f = {AF[i].Owner(), AF[i].NumShips(), AF[i].DestinationPlanet(), AF[i].TurnsRemaining()};
+		baseFleets.push_back(f);
+	}
+
+	// distances and the closest planets, the random playouts only launch to
+	// nearby planets
+	const int K = std::min<int>(NUM_NEAREST, N-1);
+	dist.resize(N*N);
+	nearest.resize(N*K);
+	for (int i = 0; i < N; i++)
+	{
+		for (int j = 0; j < N; j++)
+			dist[i*N+j] = AP[i].Distance(AP[j]);
+
+		for (int k = 0; k < K; k++)
+		{
+			int closest = -1;
+			for (int j = 0; j < N; j++)
+			{
+				if (j == i || find(nearest.begin()+i*K, nearest.begin()+i*K+k, j) != nearest.begin()+i*K+k)
+					continue;
+				if (closest == -1 || dist[i*N+j] < dist[i*N+closest])
+					closest = j;
+			}
+			nearest[i*K+k] = closest;
+		}
+	}
+
+	Node zero = {0, 0};
+	children.assign(M.size(), zero);
+	replies.assign(M.size()*E.size(), zero);
+	seeds.resize(pool.NumThreads());
+	for (unsigned int i = 0, n = seeds.size(); i < n; i++)
+		seeds[i].x = 2463534242u + i*7919u;
+
+	Batch batch(this);
+	while (true)
+	{
+		timer.Tock();
+		if (timer.Time() > deadline)
+			break;
+
+		// two batches per worker keep the queues from running dry, the next
+		// ones go in as soon as one is done
+		while (pool.Pending() < 2*pool.NumThreads())
+			pool.Submit(&batch);
+		pool.Wait(2*pool.NumThreads());
+	}
+	__atomic_store_n(&stop, true, __ATOMIC_RELEASE);
+	pool.Wait();
+
+	int bestMove = -1;
+	for (int i = 0, n = children.size(); i < n; i++)
+		if (children[i].visits > 0 && (bestMove == -1 || children[i].visits > children[bestMove].visits))
+			bestMove = i;
+
+	if (bestMove == -1)
+		return false;
+
+	best = M[bestMove];
+	return true;
+}
+
+void MCTS::RunBatch(int worker) {
+	for (int i = 0; i < BATCH_SIZE && !__atomic_load_n(&stop, __ATOMIC_ACQUIRE); i++)
+		Playout(worker);
+}
+
+void MCTS::Playout(int worker) {
+	Arena::Scope scope;
+	const int NE = E.size();
+
+	// select both order sets, the virtual loss makes the choice look bad to
+	// the other workers until the result is in
+	const int total = __sync_fetch_and_add(&root.visits, 1);
+	const int i = Select(&children[0], children.size(), total, false);
+	__sync_fetch_and_add(&children[i].visits, VIRTUAL_LOSS);
+	const int j = Select(&replies[i*NE], NE, __atomic_load_n(&children[i].visits, __ATOMIC_RELAXED), true);
+	Node& reply = replies[i*NE+j];
+	__sync_fetch_and_add(&reply.visits, VIRTUAL_LOSS);
+	__sync_fetch_and_add(&reply.wins, VIRTUAL_LOSS*1000);
+
+	FPlanetVec P(base);
+	FFleetVec  F(baseFleets);
+	IntVec forces(P.size()*3, 0);
+	IntVec hits;
+	Launch(P, F, M[i], 1);
+	Launch(P, F, E[j], 2);
+
+	unsigned int& seed = seeds[worker].x;
+	for (int t = 0, n = std::min<int>(turnsLeft, ROLLOUT_TURNS); t < n; t++)
+	{
+		if (t > 0)
+		{
+			RandomLaunch(P, F, 1, seed);
+			RandomLaunch(P, F, 2, seed);
+		}
+		Step(P, F, forces, hits);
+	}
+
+	const int reward = Reward(P, F);
+	__sync_fetch_and_add(&children[i].visits, 1 - VIRTUAL_LOSS);
+	__sync_fetch_and_add(&children[i].wins, reward);
+	__sync_fetch_and_add(&reply.visits, 1 - VIRTUAL_LOSS);
+	__sync_fetch_and_add(&reply.wins, reward - VIRTUAL_LOSS*1000);
+	__sync_fetch_and_add(&root.wins, reward);
+	__sync_fetch_and_add(&playouts, 1);
+}
+
+// UCB1, the enemy maximizes its own reward. The other workers update the
+// nodes meanwhile, visits and wins are read apart.
+int MCTS::Select(const Node* nodes, int n, int total, bool enemy) {
+	const double logN = log(double(total + 1));
+	int best = 0;
+	double bestValue = -1.0;
+	for (int k = 0; k < n; k++)
+	{
+		const int visits = __atomic_load_n(&nodes[k].visits, __ATOMIC_RELAXED);
+		if (visits <= 0)
+			return k;
+
+		double q = __atomic_load_n(&nodes[k].wins, __ATOMIC_RELAXED) / (1000.0 * visits);
+		if (enemy)
+			q = 1.0 - q;
+
+		const double value = q + UCT_C * sqrt(logN / visits);
+		if (value > bestValue)
+		{
+			bestValue = value;
+			best = k;
+		}
+	}
+	return best;
+}
+
+void MCTS::Launch(FPlanetVec& P, FFleetVec& F, const FleetVec& orders, int owner) {
+	for (unsigned int i = 0, n = orders.size(); i < n; i++)
+	{
+		const Fleet& o = orders[i];
+		P[o.SourcePlanet()].ships -= o.NumShips();
+		FFleet f = {owner, o.NumShips(), o.DestinationPlanet(), o.TurnsRemaining()};
+		F.push_back(f);
+	}
+}
+
+// every planet of owner launches with a chance of 1/4 to one of its closest
+// planets, when it can take it
+void MCTS::RandomLaunch(FPlanetVec& P, FFleetVec& F, int owner, unsigned int& seed) {
+	const int N = P.size();
+	const int K = std::min<int>(NUM_NEAREST, N-1);
+	if (K <= 0)
+		return;
+
+	for (int sid = 0; sid < N; sid++)
+	{
+		FPlanet& source = P[sid];
+		if (source.owner != owner || source.ships <= 0 || (Random(seed) & 3) != 0)
+			continue;
+
+		const int tid = nearest[sid*K + Random(seed) % K];
+		const FPlanet& target = P[tid];
+		if (target.owner == owner)
+			continue;
+
+		const int d = dist[sid*N+tid];
+		const int need = target.ships + ((target.owner > 0)? target.growth*d: 0) + 1;
+		if (need > source.ships)
+			continue;
+
+		source.ships -= need;
+		FFleet f = {owner, need, tid, d};
+		F.push_back(f);
+	}
+}
+
+// one turn of the game rules: growth, fleet movement and battles
+void MCTS::Step(FPlanetVec& P, FFleetVec& F, IntVec& forces, IntVec& hits) {
+	for (unsigned int i = 0, n = P.size(); i < n; i++)
+		if (P[i].owner > 0)
+			P[i].ships += P[i].growth;
+
+	unsigned int k = 0;
+	for (unsigned int i = 0, n = F.size(); i < n; i++)
+	{
+		FFleet& f = F[i];
+		if (--f.turns > 0)
+		{
+			F[k++] = f;
+			continue;
+		}
+
+		int* force = &forces[f.dest*3];
+		if (force[0] == 0 && force[1] == 0 && force[2] == 0)
+			hits.push_back(f.dest);
+		force[f.owner] += f.ships;
+	}
+	F.resize(k);
+
+	for (unsigned int i = 0, n = hits.size(); i < n; i++)
+	{
+		FPlanet& p = P[hits[i]];
+		int* force = &forces[hits[i]*3];
+		force[p.owner] += p.ships;
+
+		int first = 0, second = -1;
+		for (int o = 1; o < 3; o++)
+		{
+			if (force[o] > force[first])
+			{
+				second = first;
+				first = o;
+			}
+			else
+			if (second == -1 || force[o] > force[second])
+			{
+				second = o;
+			}
+		}
+
+		if (force[first] == force[second])
+		{
+			p.ships = 0;
+		}
+		else
+		{
+			p.owner = first;
+			p.ships = force[first] - force[second];
+		}
+		force[0] = force[1] = force[2] = 0;
+	}
+	hits.clear();
+}
+
+int MCTS::Reward(const FPlanetVec& P, const FFleetVec& F) {
+	int ships[3] = {0, 0, 0};
+	for (unsigned int i = 0, n = P.size(); i < n; i++)
+		ships[P[i].owner] += P[i].ships;
+	for (unsigned int i = 0, n = F.size(); i < n; i++)
+		ships[F[i].owner] += F[i].ships;
+
+	if (ships[1] + ships[2] == 0)
+		return 500;
+
+	return (1000 * ships[1]) / (ships[1] + ships[2]);
+}
@@ -0,0 +1,89 @@
+#ifndef MCTS_
+#define MCTS_
+
+#include "PlanetWars.h"
+#include "Search.h"
+#include "ThreadPool.h"
+#include "Timer.h"
+
+// Monte Carlo tree search over candidate order sets. The children of the
+// root are our order sets (the greedy DoTurn orders and the Search
+// generator moves), their children are the enemy replies, both picked with
+// UCB. Playouts continue with random launches on a compact copy of the
+// state that is stepped turn by turn with the game rules. Playouts run in
+// batches on the thread pool, the statistics are updated lock free and a
+// virtual loss steers concurrent playouts towards different children.
+class MCTS {
+public:
+	MCTS(int turnsLeft, Timer& timer, double deadline);
+
+	// Runs playouts until the deadline passes and returns the most visited
+	// order set in best. Returns false when no playout finished.
+	bool Run(ThreadPool& pool, PlanetVec& AP, FleetVec& AF, FleetVec& candidate, FleetVec& best);
+
+	int Playouts() const { return playouts; }
+
+private:
+	struct Node {
+		int visits;
+		int wins; // sum of rewards, a reward is in [0, 1000]
+	};
+
+	struct FPlanet {
+		int owner;
+		int ships;
+		int growth;
+	};
+
+	struct FFleet {
+		int owner;
+		int ships;
+		int dest;
+		int turns;
+	};
+
+	struct Seed {
+		unsigned int x;
+		char pad[60]; // keep the workers off each others cache line
+	};
+
+	class Batch: public Task {
+	public:
+		Batch(MCTS* m): mcts(m) {}
+		void Run(int worker) { mcts->RunBatch(worker); }
+	private:
+		MCTS* mcts;
+	};
+
+	typedef std::vector<FPlanet, ArenaAllocator<FPlanet> > FPlanetVec;
+	typedef std::vector<FFleet, ArenaAllocator<FFleet> >   FFleetVec;
+	typedef std::vector<Node, ArenaAllocator<Node> >       NodeVec;
+	typedef std::vector<Seed, ArenaAllocator<Seed> >       SeedVec;
+
+	int    turnsLeft;
+	Timer& timer;
+	double deadline;
+	bool   stop; // read by the workers
+	int    playouts;
+
+	Search::MoveList M; // our order sets
+	Search::MoveList E; // enemy order sets, planet ids are not flipped
+	FPlanetVec base;
+	FFleetVec  baseFleets;
+	IntVec     dist;    // N x N distances
+	IntVec     nearest; // per planet the closest other planets
+	Node       root;
+	NodeVec    children; // our order sets
+	NodeVec    replies;  // enemy order sets per child, |M| x |E|
+	SeedVec    seeds;
+
+	void RunBatch(int worker);
+	void Playout(int worker);
+	int  Select(const Node*, int n, int total, bool enemy);
+	void Launch(FPlanetVec&, FFleetVec&, const FleetVec&, int owner);
+	void RandomLaunch(FPlanetVec&, FFleetVec&, int owner, unsigned int& seed);
+	void Step(FPlanetVec&, FFleetVec&, IntVec& forces, IntVec& hits);
+	int  Reward(const FPlanetVec&, const FFleetVec&);
+};
+
+#endif
@@ -2,16 +2,17 @@
 #include "Logger.h"
 #include "KnapSack.h"
 #include "Simulator.h"
+#include "Counters.h"
 
 #include <algorithm>
 #include <limits>
-#include <map>
 
 namespace map {
 	#include "Helper.inl"
 }
 
-Map::Map(std::vector<Planet>& ap): AP(ap) {
+Map::Map(PlanetVec& ap): AP(ap), frontLine(ap.size()) {
+	Counters::Add(Counters::MAPS);
 	map::gAP = &AP;
 	// compute our planets, enemy planets etc
 	for (unsigned int i = 0, n = AP.size(); i < n; i++)
@@ -27,7 +28,7 @@ Map::Map(std::vector<Planet>& ap): AP(ap) {
 	}
 
 	// compute frontline, for each enemyplanet find our closest planet
-	std::map<int, int> tmp;
+	IntVec closest(AP.size(), -1);
 	for (unsigned int i = 0, n = EPIDX.size(); i < n; i++)
 	{
 		const Planet& eP = AP[EPIDX[i]];
@@ -36,28 +37,29 @@ Map::Map(std::vector<Planet>& ap): AP(ap) {
 		{
 			const Planet& mP = AP[MPIDX[j]];
 			const int mid = mP.PlanetID();
-			if (tmp.find(eid) == tmp.end())
+			if (closest[eid] == -1)
 			{
-				tmp[eid] = mid;
+				closest[eid] = mid;
 			}
 			else
 			{
 				const int d1 = eP.Distance(mP);
-				const int d2 = eP.Distance(AP[tmp[eid]]);
+				const int d2 = eP.Distance(AP[closest[eid]]);
 				if (d1 < d2)
 				{
-					tmp[eid] = mid;
+					closest[eid] = mid;
 				}
 			}
 		}
 	}
 
-	typedef std::map<int, int>::iterator MIter;
-	for (MIter i = tmp.begin(); i != tmp.end(); i++)
+	for (unsigned int eid = 0, n = closest.size(); eid < n; eid++)
 	{
-		if (find(FLPIDX.begin(), FLPIDX.end(), i->second) == FLPIDX.end())
+		const int mid = closest[eid];
+		if (mid != -1 && !frontLine.Has(mid))
 		{
-			FLPIDX.push_back(i->second);
+			FLPIDX.push_back(mid);
+			frontLine.Add(mid);
 		}
 	}
 
@@ -66,7 +68,7 @@ Map::Map(std::vector<Planet>& ap): AP(ap) {
 		const Planet& p = AP[MPIDX[i]];
 		const int pid = p.PlanetID();
 
-		if (find(FLPIDX.begin(), FLPIDX.end(), pid) != FLPIDX.end())
+		if (frontLine.Has(pid))
 			continue;
 
 		const int eid = GetClosestPlanetIdx(p.Loc(), EPIDX);
@@ -86,6 +88,7 @@ Map::Map(std::vector<Planet>& ap): AP(ap) {
 		if (edist <= mdist)
 		{
 			FLPIDX.push_back(pid);
+			frontLine.Add(pid);
 		}
 	}
 }
@@ -106,9 +109,9 @@ int Map::GetClosestFrontLinePlanetIdx(const Planet& p) {
 	return closestPid;
 }
 
-std::vector<int> Map::GetPlanetIDsInRadius(const vec3<double>& pos,
-					const std::vector<int>& candidates, const int r) {
-	std::vector<int> PIRIDX;
+IntVec Map::GetPlanetIDsInRadius(const vec3<double>& pos,
+					const IntVec& candidates, const int r) {
+	IntVec PIRIDX;
 	for (unsigned int i = 0, n = candidates.size(); i < n; i++)
 	{
 		const Planet& p = AP[candidates[i]];
@@ -120,7 +123,7 @@ std::vector<int> Map::GetPlanetIDsInRadius(const vec3<double>& pos,
 	return PIRIDX;
 }
 
-int Map::GetClosestPlanetIdx(const vec3<double>& pos, const std::vector<int>& candidates) {
+int Map::GetClosestPlanetIdx(const vec3<double>& pos, const IntVec& candidates) {
 	int closestDist = std::numeric_limits<int>::max();
 	int pid = -1;
 	for (unsigned int i = 0, n = candidates.size(); i < n; i++)
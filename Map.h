@@ -2,27 +2,30 @@
 #define MAP_
 
 #include "PlanetWars.h"
+#include "PlanetSet.h"
 #include "vec3.h"
 
 #include <vector>
 
 class Map {
 public:
-	Map(std::vector<Planet>&);
+	Map(PlanetVec&);
 
 	int GetClosestFrontLinePlanetIdx(const Planet&);
-	int GetClosestPlanetIdx(const vec3<double>&, const std::vector<int>&);
+	int GetClosestPlanetIdx(const vec3<double>&, const IntVec&);
 
-	std::vector<int>  GetPlanetIDsInRadius(const vec3<double>&, const std::vector<int>&, const int);
-	std::vector<int>& GetFrontLine(){ return FLPIDX; }
+	IntVec  GetPlanetIDsInRadius(const vec3<double>&, const IntVec&, const int);
+	IntVec& GetFrontLine(){ return FLPIDX; }
+	bool    IsFrontLine(int pid) const { return frontLine.Has(pid); }
 
 private:
-	const std::vector<Planet>& AP; // hard copy of all the planets
+	const PlanetVec& AP; // hard copy of all the planets
 
-	std::vector<int>  FLPIDX;  // planets on the front line
-	std::vector<int>  NPIDX;   // neutral planets
-	std::vector<int>  EPIDX;   // enemy planets
-	std::vector<int>  MPIDX;   // all planets belonging to us
+	IntVec  FLPIDX;  // planets on the front line
+	PlanetSet frontLine; // the same as a set
+	IntVec  NPIDX;   // neutral planets
+	IntVec  EPIDX;   // enemy planets
+	IntVec  MPIDX;   // all planets belonging to us
 };
 
 #endif
@@ -0,0 +1,225 @@
+#include "MapCache.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MAGIC   "E323"
+#define VERSION 1 // of the file layout and of what the tables hold
+
+std::string         MapCache::dir;
+__thread MapCache*  MapCache::current = NULL;
+
+// the finalizer of splitmix64
+static inline unsigned long long Mix(unsigned long long x) {
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+static inline unsigned long long Bits(double d) {
+	unsigned long long bits;
+	memcpy(&bits, &d, sizeof(bits));
+	return bits;
+}
+
+template <typename T>
+static bool Write(FILE* file, const std::vector<T>& v) {
+	return v.empty() || fwrite(&v[0], sizeof(T), v.size(), file) == v.size();
+}
+
+MapCache::MapCache():
+	key(0),
+	dirty(false)
+{}
+
+MapCache* MapCache::Instance() {
+	static MapCache cache;
+	return (current != NULL)? current: &cache;
+}
+
+bool MapCache::Open(const char* d) {
+	struct stat st;
+	mkdir(d, 0755);
+	if (stat(d, &st) != 0 || !S_ISDIR(st.st_mode))
+		return false;
+	dir = d;
+	return true;
+}
+
+unsigned long long MapCache::Key(const PlanetVec& AP) {
+	unsigned long long k = Mix(AP.size());
+	for (unsigned int i = 0, n = AP.size(); i < n; i++)
+	{
+		k = Mix(k ^ Bits(AP[i].X()));
+		k = Mix(k ^ Bits(AP[i].Y()));
+		k = Mix(k ^ (unsigned int)AP[i].GrowthRate());
+	}
+	return (k == 0)? 1: k;
+}
+
+unsigned long long MapCache::Key(const IntVec& w, const DoubleVec& v, int W) {
+	unsigned long long k = Mix((unsigned int)W);
+	for (unsigned int i = 0, n = w.size(); i < n; i++)
+	{
+		k = Mix(k ^ (unsigned int)w[i]);
+		k = Mix(k ^ Bits(v[i]));
+	}
+	return k;
+}
+
+std::string MapCache::Path() const {
+	char name[32];
+	snprintf(name, sizeof(name), "/%016llx.map", key);
+	return dir + name;
+}
+
+void MapCache::Update(const PlanetVec& AP, Router& router) {
+	if (dir.empty() || AP.empty())
+		return;
+	const unsigned long long k = Key(AP);
+	if (k == key)
+		return;
+
+	key = k;
+	xy.clear();
+	growth.clear();
+	for (unsigned int i = 0, n = AP.size(); i < n; i++)
+	{
+		xy.push_back(AP[i].X());
+		xy.push_back(AP[i].Y());
+		growth.push_back(AP[i].GrowthRate());
+	}
+	expands.clear();
+	dirty = !Load(router);
+	LOG("MAP CACHE: "<<Path()<<(dirty? " new": " loaded"));
+}
+
+// the file of the map when it is valid, read from a mapping of it
+bool MapCache::Load(Router& router) {
+	const int fd = open(Path().c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	void* data = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(Header))
+		data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return false;
+
+	const Header* h = static_cast<const Header*>(data);
+	const int n = growth.size();
+	bool valid = memcmp(h->magic, MAGIC, 4) == 0 && h->version == VERSION && h->key == key &&
+		h->numPlanets == n && h->numHubs >= 0 && h->numExpands >= 0 && h->numExpands <= MAX_EXPANDS &&
+		h->numIndices >= 0;
+	const size_t size = sizeof(Header) + sizeof(double)*2*n + sizeof(unsigned long long)*h->numExpands +
+		sizeof(int)*(n + n*(n+1) + h->numHubs + h->numExpands + h->numIndices);
+	valid = valid && size == (size_t)st.st_size;
+
+	const double*             fxy     = reinterpret_cast<const double*>(h + 1);
+	const unsigned long long* keys    = reinterpret_cast<const unsigned long long*>(fxy + 2*n);
+	const int*                fgrowth = reinterpret_cast<const int*>(keys + h->numExpands);
+	const int*                offsets = fgrowth + n;
+	const int*                hubs    = offsets + n*(n+1);
+	const int*                sizes   = hubs + h->numHubs;
+	const int*                indices = sizes + h->numExpands;
+	valid = valid && memcmp(fxy, &xy[0], sizeof(double)*2*n) == 0 &&
+		memcmp(fgrowth, &growth[0], sizeof(int)*n) == 0;
+	for (int i = 0; i < n*(n+1) && valid; i++)
+		valid = offsets[i] >= 0 && offsets[i] <= h->numHubs && (i % (n+1) == 0 || offsets[i] >= offsets[i-1]);
+	for (int i = 0; i < h->numHubs && valid; i++)
+		valid = hubs[i] >= 0 && hubs[i] < n;
+
+	if (valid)
+	{
+		router.Import(offsets, hubs);
+		for (int i = 0, j = 0; i < h->numExpands && sizes[i] >= 0 && j + sizes[i] <= h->numIndices; j += sizes[i++])
+			expands.push_back(Expand(keys[i], std::vector<int>(indices + j, indices + j + sizes[i])));
+	}
+	munmap(data, st.st_size);
+	return valid;
+}
+
+bool MapCache::FindExpand(const IntVec& w, const DoubleVec& v, int W, IntVec& indices) const {
+	if (dir.empty())
+		return false;
+	const unsigned long long k = Key(w, v, W);
+	for (unsigned int i = 0, n = expands.size(); i < n; i++)
+	{
+		const std::vector<int>& e = expands[i].second;
+		if (expands[i].first == k && (e.empty() || *std::max_element(e.begin(), e.end()) < (int)w.size()))
+		{
+			indices.assign(e.begin(), e.end());
+			return true;
+		}
+	}
+	return false;
+}
+
+void MapCache::StoreExpand(const IntVec& w, const DoubleVec& v, int W, const IntVec& indices) {
+	if (dir.empty())
+		return;
+	if (expands.size() == MAX_EXPANDS)
+		expands.erase(expands.begin());
+	expands.push_back(Expand(Key(w, v, W), std::vector<int>(indices.begin(), indices.end())));
+	dirty = true;
+}
+
+// to a temporary file that is renamed, so games reading the same map at
+// the same time see the old file or the new one
+void MapCache::Save(Router& router) {
+	if (dir.empty() || !dirty)
+		return;
+	dirty = false;
+
+	std::vector<int> offsets, hubs;
+	router.Export(offsets, hubs);
+	const int n = growth.size();
+	if (offsets.size() != (unsigned int)(n*(n+1)))
+		return;
+
+	Header h;
+	memcpy(h.magic, MAGIC, 4);
+	h.version    = VERSION;
+	h.key        = key;
+	h.numPlanets = n;
+	h.numHubs    = hubs.size();
+	h.numExpands = expands.size();
+	h.numIndices = 0;
+	std::vector<unsigned long long> keys;
+	std::vector<int> sizes, indices;
+	for (unsigned int i = 0, m = expands.size(); i < m; i++)
+	{
+		keys.push_back(expands[i].first);
+		sizes.push_back(expands[i].second.size());
+		indices.insert(indices.end(), expands[i].second.begin(), expands[i].second.end());
+	}
+	h.numIndices = indices.size();
+
+	std::string tmp = Path() + ".XXXXXX";
+	const int fd = mkstemp(&tmp[0]);
+	FILE* file = (fd < 0)? NULL: fdopen(fd, "wb");
+	if (file == NULL)
+	{
+		if (fd >= 0)
+			close(fd);
+		return;
+	}
+	bool ok = fwrite(&h, sizeof(h), 1, file) == 1;
+	ok = ok && Write(file, xy) && Write(file, keys) && Write(file, growth) && Write(file, offsets);
+	ok = ok && Write(file, hubs) && Write(file, sizes) && Write(file, indices);
+	ok = (fclose(file) == 0) && ok;
+	if (!ok || rename(tmp.c_str(), Path().c_str()) != 0)
+		unlink(tmp.c_str());
+	LOG("MAP CACHE: "<<Path()<<(ok? " saved": " not saved"));
+}
@@ -0,0 +1,79 @@
+#ifndef MAPCACHE_
+#define MAPCACHE_
+
+#include "PlanetWars.h"
+#include "Router.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Work that is the same in every game on a map, kept on disk from one game
+// to the next: the hub tables of the Router and the knapsack selections of
+// the turn 0 expansion. A map is known by a key of its planet locations and
+// growth rates. Its file in the cache directory holds a header, the layout
+// it was made for and the tables, in native byte order and laid out to be
+// read in place from a mapping of the file. A file of another version or
+// layout is ignored, and replaced when the game is saved. Nothing is read
+// or written until a directory is opened.
+class MapCache {
+public:
+	MapCache();
+
+	// the cache of the game played on this thread, a shared one unless
+	// SetInstance gave the thread its own
+	static MapCache* Instance();
+	static void      SetInstance(MapCache* cache) { current = cache; }
+
+	// the directory of the files, made when missing, for all games of the
+	// process and before any is played. False when it can not be used.
+	static bool Open(const char* dir);
+
+	// call at the start of a turn after Router::Update, on a different map
+	// the router gets the tables of the file of the map
+	void Update(const PlanetVec& AP, Router& router);
+
+	// the selection of a knapsack of the same items and capacity
+	bool FindExpand(const IntVec& w, const DoubleVec& v, int W, IntVec& indices) const;
+	void StoreExpand(const IntVec& w, const DoubleVec& v, int W, const IntVec& indices);
+
+	// writes the file of the map when it was not on disk or got a new
+	// selection, the router builds its missing tables for it
+	void Save(Router& router);
+
+private:
+	enum { MAX_EXPANDS = 8 }; // selections per map, the oldest is dropped
+
+	// followed by the sections double xy[2*numPlanets], unsigned long long
+	// expandKeys[numExpands], int growth[numPlanets], int
+	// offsets[numPlanets*(numPlanets+1)], int hubs[numHubs], int
+	// expandSizes[numExpands] and int expands[numIndices]
+	struct Header {
+		char               magic[4];
+		int                version;
+		unsigned long long key;
+		int                numPlanets;
+		int                numHubs;
+		int                numExpands;
+		int                numIndices;
+	};
+
+	typedef std::pair<unsigned long long, std::vector<int> > Expand;
+
+	unsigned long long  key;     // of the map, 0 before the first
+	std::vector<double> xy;      // the layout
+	std::vector<int>    growth;
+	std::vector<Expand> expands;
+	bool                dirty;   // differs from the file
+
+	static std::string         dir;
+	static __thread MapCache*  current;
+
+	static unsigned long long Key(const PlanetVec& AP);
+	static unsigned long long Key(const IntVec& w, const DoubleVec& v, int W);
+
+	std::string Path() const;
+	bool Load(Router& router);
+};
+
+#endif
@@ -0,0 +1,72 @@
+#include "MinCostFlow.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <limits>
+
+MinCostFlow::MinCostFlow(int numNodes):
+	adjacent(numNodes),
+	cost(0)
+{
+}
+
+int MinCostFlow::AddEdge(int from, int to, int capacity, int c) {
+	ASSERT(from >= 0 && from < int(adjacent.size()) && to >= 0 && to < int(adjacent.size()));
+	const Edge forward  = {to,   capacity,  c, 0};
+	const Edge backward = {from, 0,        -c, 0};
+	adjacent[from].push_back(edges.size());
+	edges.push_back(forward);
+	adjacent[to].push_back(edges.size());
+	edges.push_back(backward);
+	return edges.size() - 2;
+}
+
+int MinCostFlow::Solve(int source, int sink, int maxFlow) {
+	const int INF = std::numeric_limits<int>::max();
+	const int n = adjacent.size();
+	IntVec distance(n), via(n);
+	int total = 0;
+	while (total < maxFlow)
+	{
+		// cheapest path in the residual network, the residual edges may
+		// have negative costs
+		std::fill(distance.begin(), distance.end(), INF);
+		std::fill(via.begin(), via.end(), -1);
+		distance[source] = 0;
+		for (bool relaxed = true; relaxed;)
+		{
+			relaxed = false;
+			for (int u = 0; u < n; u++)
+			{
+				if (distance[u] == INF)
+					continue;
+
+				for (unsigned int i = 0, m = adjacent[u].size(); i < m; i++)
+				{
+					const Edge& e = edges[adjacent[u][i]];
+					if (e.capacity > e.flow && distance[u] + e.cost < distance[e.to])
+					{
+						distance[e.to] = distance[u] + e.cost;
+						via[e.to] = adjacent[u][i];
+						relaxed = true;
+					}
+				}
+			}
+		}
+		if (distance[sink] == INF)
+			break;
+
+		int push = maxFlow - total;
+		for (int v = sink; v != source; v = edges[via[v] ^ 1].to)
+			push = std::min(push, edges[via[v]].capacity - edges[via[v]].flow);
+
+		for (int v = sink; v != source; v = edges[via[v] ^ 1].to)
+		{
+			edges[via[v]].flow     += push;
+			edges[via[v] ^ 1].flow -= push;
+		}
+		total += push;
+		cost  += push*distance[sink];
+	}
+	return total;
+}
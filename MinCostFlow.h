@@ -0,0 +1,39 @@
+#ifndef MINCOSTFLOW_
+#define MINCOSTFLOW_
+
+#include "Arena.h"
+
+#include <vector>
+
+// Min cost flow with integral capacities and costs, successive shortest
+// paths found with Bellman-Ford. Meant for the small networks of the ship
+// allocation, a few dozen nodes.
+class MinCostFlow {
+public:
+	MinCostFlow(int numNodes);
+
+	// returns the id of the edge
+	int AddEdge(int from, int to, int capacity, int cost);
+
+	// sends at most maxFlow from source to sink at the least cost, returns
+	// the flow sent
+	int Solve(int source, int sink, int maxFlow);
+
+	int Flow(int edge) const { return edges[edge].flow; }
+	int Cost() const         { return cost; }
+
+private:
+	struct Edge {
+		int to;
+		int capacity;
+		int cost;
+		int flow;
+	};
+
+	// edge e and its residual edge e^1 are stored next to each other
+	std::vector<Edge, ArenaAllocator<Edge> >     edges;
+	std::vector<IntVec, ArenaAllocator<IntVec> > adjacent;
+	int cost;
+};
+
+#endif
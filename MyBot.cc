@@ -3,8 +3,25 @@
 #include "Logger.h"
 #include "vec3.h"
 #include "Map.h"
+#include "PlanetSet.h"
 #include "KnapSack.h"
+#include "MinCostFlow.h"
+#include "Search.h"
+#include "MCTS.h"
+#include "Endgame.h"
+#include "ThreadPool.h"
 #include "Timer.h"
+#include "Trace.h"
+#include "FlightRecorder.h"
+#include "Router.h"
+#include "Strength.h"
+#include "SimBase.h"
+#include "PlanCache.h"
+#include "MapCache.h"
+#include "Timeline.h"
+#include "Counters.h"
+#include "Ponder.h"
+#include "Bot.h"
 
 #include <iostream>
 #include <algorithm>
@@ -12,82 +29,151 @@
 #include <cmath>
 #include <string>
 #include <queue>
+#include <cstdlib>
 
-#ifdef DEBUG
-	#include <sys/types.h>
-	#include <unistd.h>
-	#include <signal.h>
-#endif
 
-PlanetWars* gPW = NULL;
-int turn        = 0;
+// thread local, the game played on a thread is set by its Bot
+__thread FleetVec*   gIssued     = NULL;  // orders of this turn, sent at the end of DoTurn
+__thread ThreadPool* gPool       = NULL;
+__thread int         turn        = 0;
+__thread bool        SEARCH      = false; // refine the greedy orders with Search, enabled by --search
+__thread bool        MONTE_CARLO = false; // refine the greedy orders with MCTS, enabled by --mcts
+__thread bool        ENDGAME     = false; // solve small states exactly, enabled by --endgame
+
+TraceWriter* gTrace = NULL; // binary game record, enabled by --trace file
 int MAX_TURNS   = 200;
+double TURN_TIME = 1.0;   // seconds per turn given by the game engine
+double SEARCH_TIME = 0.8; // fraction of the turn time that DoTurn may use
 
 namespace bot {
 	#include "Helper.inl"
 }
 
-bool Defend(int tid, std::vector<Planet>& AP, std::vector<Fleet>& AF,
-				std::vector<int>& NTPIDX, std::vector<int>& EFIDX,
-				std::vector<Fleet>& orders, bool restore) {
+// Plans the supply of the sources to the wanted targets at the least total
+// distance, as a min cost flow. Target k takes demand[k] ships from the
+// sources within horizon[k], all or none. While the supply does not cover
+// all targets the last target that falls short is dropped. The orders are
+// added, not applied.
+void Route(const IntVec& sources, const IntVec& supply, IntVec& wanted, IntVec& demand, IntVec& horizon,
+				const PlanetVec& AP, FleetVec& orders) {
+	// nodes: 0 the source, 1..S the planets with ships, S+1..S+T the
+	// targets, S+T+1 the sink
+	const int S = sources.size();
+	while (!wanted.empty())
+	{
+		const int T = wanted.size();
+		MinCostFlow flow(S + T + 2);
+		int totalDemand = 0;
+		for (int j = 0; j < S; j++)
+			flow.AddEdge(0, 1 + j, supply[j], 0);
+		IntVec edges;
+		for (int j = 0; j < S; j++)
+		{
+			for (int k = 0; k < T; k++)
+			{
+				const int dist = AP[sources[j]].Distance(AP[wanted[k]]);
+				edges.push_back(flow.AddEdge(1 + j, 1 + S + k, (dist <= horizon[k])? demand[k]: 0, dist));
+			}
+		}
+		IntVec sinks;
+		for (int k = 0; k < T; k++)
+		{
+			sinks.push_back(flow.AddEdge(1 + S + k, S + T + 1, demand[k], 0));
+			totalDemand += demand[k];
+		}
+
+		if (flow.Solve(0, S + T + 1, totalDemand) == totalDemand)
+		{
+			for (int j = 0; j < S; j++)
+			{
+				const int sid = sources[j];
+				for (int k = 0; k < T; k++)
+				{
+					const int numShips = flow.Flow(edges[j*T + k]);
+					if (numShips <= 0)
+						continue;
+
+					const int dist = AP[sid].Distance(AP[wanted[k]]);
+					orders.push_back(Fleet(1, numShips, sid, wanted[k], dist, dist));
+				}
+			}
+			return;
+		}
+
+		int drop = T - 1;
+		while (flow.Flow(sinks[drop]) == demand[drop])
+			drop--;
+		wanted.erase(wanted.begin() + drop);
+		demand.erase(demand.begin() + drop);
+		horizon.erase(horizon.begin() + drop);
+	}
+}
+
+// Sends the ships the target lacks when the enemy takes it, from the sources
+// that arrive by then at the least total distance. When the simulation still
+// sees the enemy take it, the ships the enemy keeps are added to the demand
+// and the supply is routed again, until it falls short.
+bool Defend(int tid, PlanetVec& AP, FleetVec& AF,
+				IntVec& NTPIDX, IntVec& EFIDX,
+				FleetVec& orders, bool restore) {
 
 	Simulator end, sim;
-	end.Start(MAX_TURNS-turn, AP, AF, false, true);
+	end.StartPlanet(MAX_TURNS-turn, AP, AF, tid);
 	Simulator::PlanetOwner& enemy = end.GetFirstEnemyOwner(tid);
-	Planet& target = AP[tid];
 	bot::gTarget = tid;
 	sort(NTPIDX.begin(), NTPIDX.end(), bot::SortOnDistanceToTarget);
-	bool success = false;
+	IntVec supply;
 	for (unsigned int j = 0, m = NTPIDX.size(); j < m; j++)
 	{
-		Planet& source = AP[NTPIDX[j]];
-		const int sid = source.PlanetID();
-		if (source.NumShips() <= 0)
-			continue;
-
-		const int dist = target.Distance(source);
-		if (dist > enemy.time)
-			continue;
-
-		source.Backup();
-		sim.Start(enemy.time, AP, AF, false, true);
-		int numShips = sim.GetPlanet(tid).NumShips();
-		numShips = std::min<int>(numShips, source.NumShips()-bot::GetIncommingFleets(sid, EFIDX));
+		const Planet& source = AP[NTPIDX[j]];
+		const int numShips = source.NumShips() - bot::GetIncommingFleets(source.PlanetID(), EFIDX);
+		supply.push_back((source.NumShips() > 0)? std::max(0, numShips): 0);
+	}
 
-		if (numShips <= 0)
-			continue;
+	sim.StartPlanet(enemy.time, AP, AF, tid);
+	int numShips = sim.GetPlanet(tid).NumShips();
+	bool success = false;
+	while (!success && numShips > 0)
+	{
+		IntVec wanted(1, tid), demand(1, numShips), horizon(1, enemy.time);
+		Route(NTPIDX, supply, wanted, demand, horizon, AP, orders);
+		if (wanted.empty())
+			break;
 
-		source.RemoveShips(numShips);
-		Fleet order(1, numShips, sid, tid, dist, dist);
-		AF.push_back(order);
-		orders.push_back(order);
-		sim.Start(enemy.time, AP, AF, false, true);
-		if (sim.IsMyPlanet(tid))
+		for (unsigned int j = 0, m = orders.size(); j < m; j++)
 		{
-			success = true;
-			break;
+			AP[orders[j].SourcePlanet()].RemoveShips(orders[j].NumShips());
+			AF.push_back(orders[j]);
 		}
-	}
-	if (!success || restore)
-	{
-		for (unsigned int j = 0, m = orders.size(); j < m; j++)
-			AP[orders[j].SourcePlanet()].Restore();
+		sim.StartPlanet(enemy.time, AP, AF, tid);
+		success = sim.IsMyPlanet(tid);
+		if (success && !restore)
+			break;
 
+		const int more = sim.GetPlanet(tid).NumShips();
+		for (unsigned int j = 0, m = orders.size(); j < m; j++)
+			AP[orders[j].SourcePlanet()].AddShips(orders[j].NumShips());
 		AF.erase(AF.begin() + AF.size() - orders.size(), AF.end());
-		orders.clear();
+		if (!success)
+		{
+			orders.clear();
+			numShips += std::max(1, more);
+		}
 	}
+	if (!success)
+		orders.clear();
 	return success;
 }
 
-bool Attack(Map& map, std::vector<int>& EPIDX, int sid, int tid, std::vector<Planet>& AP, std::vector<Fleet>& AF,
-				std::vector<int>& EFIDX, std::vector<Fleet>& orders, bool restore) {
+bool Attack(Map& map, IntVec& EPIDX, int sid, int tid, PlanetVec& AP, FleetVec& AF,
+				IntVec& EFIDX, FleetVec& orders, bool restore) {
 
 	Simulator sim;
 	bool canAttack = false;
 	Planet& source = AP[sid];
 	Planet& target = AP[tid];
 	const int dist = source.Distance(target);
-	sim.Start(dist, AP, AF, false, true);
+	sim.StartPlanet(dist, AP, AF, tid);
 	int numShipsRequired = sim.GetPlanet(tid).NumShips();
 	int numShips = source.NumShips()-bot::GetIncommingFleets(sid, EFIDX);
 	canAttack = numShips > numShipsRequired;
@@ -123,41 +209,480 @@ bool Attack(Map& map, std::vector<int>& EPIDX, int sid, int tid, std::vector<Pla
 	return canAttack;
 }
 
-void IssueOrders(std::vector<Fleet>& orders) {
+// overtake a neutral planet right after the enemy captured it, enemyTime is
+// the turn the enemy arrives
+bool Snipe(int tid, int enemyTime, PlanetVec& AP, FleetVec& AF,
+				IntVec& NTPIDX, IntVec& EPIDX, IntVec& EFIDX, IntVec& MFIDX,
+				FleetVec& orders) {
+
+	Simulator sim;
+	Planet& target = AP[tid];
+	bot::gTarget = tid;
+	sort(NTPIDX.begin(), NTPIDX.end(), bot::SortOnDistanceToTarget);
+	bool success = false;
+	for (unsigned int j = 0, m = NTPIDX.size(); j < m; j++)
+	{
+		Planet& source = AP[NTPIDX[j]];
+		const int sid = source.PlanetID();
+		const int dist = target.Distance(source);
+
+		// not enough ships
+		if (source.NumShips() <= 0)
+			continue;
+
+		sim.StartPlanet(dist, AP, AF, tid);
+		int numShips =
+			std::min<int>(source.NumShips()-bot::GetIncommingFleets(sid,
+			EFIDX), sim.GetPlanet(tid).NumShips() + 1);
+
+
+		// we don't wanna be sniped, just wait
+		if (dist <= enemyTime)
+		{
+			break;
+		}
+
+		// only snipe when we are locally stronger or equal and the timedelay = 1
+		if (dist > enemyTime+1 && bot::GetStrength(tid, dist, NTPIDX, MFIDX) < bot::GetStrength(tid, dist, EPIDX, EFIDX))
+			continue;
+
+		if (numShips > 0)
+		{
+			Fleet order(1, numShips, sid, tid, dist, dist);
+			orders.push_back(order);
+			AF.push_back(order);
+			source.Backup();
+			source.RemoveShips(numShips);
+
+			sim.StartPlanet(dist, AP, AF, tid);
+			if (sim.IsMyPlanet(tid))
+			{
+				success = true;
+				break;
+			}
+		}
+	}
+	if (!success)
+	{
+		for (unsigned int j = 0, m = orders.size(); j < m; j++)
+			AP[orders[j].SourcePlanet()].Restore();
+
+		AF.erase(AF.begin() + AF.size() - orders.size(), AF.end());
+		orders.clear();
+	}
+	return success;
+}
+
+// State shared by the evaluations of one phase, read only while they run
+struct Context {
+	int        turn;
+	PlanetVec* AP;
+	FleetVec*  AF;
+	IntVec*    EPIDX;
+	IntVec*    EFIDX;
+	IntVec*    MFIDX;
+	Map*       map;
+	const SimBase* base;  // of the fleets AF
+	const Ponder* ponder; // thinking ahead of the turn, NULL when not
+};
+
+// the real turn waits for the thinking ahead to return
+inline bool Aborted(const Ponder* ponder) {
+	return ponder != NULL && ponder->Aborted();
+}
+
+// Feasibility check of a single target on a private copy of the state, so
+// the checks of one phase can run in parallel. NTPIDX holds the source order
+// the serial run would see, the caller replays the sorts of the serial run to
+// keep its own order in step.
+class Evaluation: public Task {
+public:
+	enum Phase { SNIPE, DEFEND, ATTACK };
+
+	Evaluation(const Context* c, Phase p, int s, int t, int e, const IntVec& sources):
+		context(c),
+		phase(p),
+		sid(s),
+		tid(t),
+		enemyTime(e),
+		NTPIDX(sources),
+		success(false),
+		cached(false),
+		ran(false)
+	{}
+
+	void Run(int) {
+		if (Aborted(context->ponder))
+			return;
+
+		ran = true;
+		Arena::Scope scope;
+		PlanetVec AP(*context->AP);
+		FleetVec  AF(*context->AF);
+		FleetVec  result;
+		SimBase::Scope bind(context->base, AF);
+		turn     = context->turn;
+		bot::gAP = &AP;
+		bot::gAF = &AF;
+		switch (phase)
+		{
+			case SNIPE:
+				success = Snipe(tid, enemyTime, AP, AF, NTPIDX, *context->EPIDX, *context->EFIDX, *context->MFIDX, result);
+				break;
+			case DEFEND:
+				success = Defend(tid, AP, AF, NTPIDX, *context->EFIDX, result, false);
+				break;
+			case ATTACK:
+				success = Attack(*context->map, *context->EPIDX, sid, tid, AP, AF, *context->EFIDX, result, true);
+				break;
+		}
+		// reserved by Evaluate, the worker may not allocate from the arena of
+		// the caller
+		orders.insert(orders.end(), result.begin(), result.end());
+	}
+
+	const Context* context;
+	Phase    phase;
+	int      sid;
+	int      tid;
+	int      enemyTime;
+	IntVec   NTPIDX;
+	bool     success;
+	bool     cached; // found in the plan cache, not run
+	bool     ran;    // not left out after an abort
+	IntVec   inputs;
+	FleetVec orders;
+};
+
+typedef std::vector<Evaluation, ArenaAllocator<Evaluation> > EvaluationVec;
+
+// What GetStrength(tid, dist, PIDX, FIDX) reads for any dist up to range:
+// the planets closer to the target with their ships and the fleets of FIDX
+// heading for them
+void GetStrengthInputs(int tid, int range, const IntVec& PIDX, const IntVec& FIDX,
+				PlanetVec& AP, FleetVec& AF, IntVec& inputs) {
+	const Planet& target = AP[tid];
+	for (unsigned int i = 0, n = PIDX.size(); i < n; i++)
+	{
+		const Planet& p = AP[PIDX[i]];
+		const int pid = p.PlanetID();
+		if (pid == tid || p.Distance(target) >= range)
+			continue;
+
+		inputs.push_back(pid);
+		inputs.push_back(p.NumShips());
+		const unsigned int count = inputs.size();
+		inputs.push_back(0);
+		for (unsigned int j = 0, m = FIDX.size(); j < m; j++)
+		{
+			const Fleet& f = AF[FIDX[j]];
+			if (f.DestinationPlanet() != pid)
+				continue;
+
+			inputs.push_back(f.NumShips());
+			inputs.push_back(turn + f.TurnsRemaining());
+			inputs[count]++;
+		}
+	}
+}
+
+// What a snipe or defend check of tid reads: param, the target, the fleets
+// heading for it and the sources in the order the check sorts them, with
+// their ships and the enemy ships heading for them. A defend only looks at
+// whether a source has ships when it is further away than the last fleet
+// arrives. Ships and arrivals are counted from the start of the game, so a
+// target that only grew since the last turn has the same inputs. A snipe
+// also compares the strength of both sides around the target, up to the
+// furthest source, which reads the planets of either side in that range.
+// Those ships are counted as they are, the enemy planets grow every turn.
+void GetPlanInputs(Evaluation::Phase phase, int tid, int param, const IntVec& sources,
+				PlanetVec& AP, FleetVec& AF, IntVec& EPIDX, IntVec& EFIDX, IntVec& MFIDX, IntVec& inputs) {
+	const Planet& target = AP[tid];
+	inputs.clear();
+	inputs.push_back(param);
+	inputs.push_back(target.Owner());
+	inputs.push_back(target.NumShips() - (target.Owner() == 0? 0: turn*target.GrowthRate()));
+	int last = 0;
+	for (unsigned int i = 0, n = AF.size(); i < n; i++)
+	{
+		const Fleet& f = AF[i];
+		if (f.DestinationPlanet() != tid)
+			continue;
+
+		inputs.push_back(f.Owner());
+		inputs.push_back(f.NumShips());
+		inputs.push_back(turn + f.TurnsRemaining());
+		last = std::max(last, f.TurnsRemaining());
+	}
+
+	IntVec sorted(sources);
+	bot::gTarget = tid;
+	sort(sorted.begin(), sorted.end(), bot::SortOnDistanceToTarget);
+	for (unsigned int i = 0, n = sorted.size(); i < n; i++)
+	{
+		const Planet& source = AP[sorted[i]];
+		inputs.push_back(source.PlanetID());
+		if (phase == Evaluation::DEFEND && source.Distance(target) > last)
+		{
+			inputs.push_back(source.NumShips() > 0);
+			continue;
+		}
+		inputs.push_back(source.NumShips());
+		inputs.push_back(bot::GetIncommingFleets(source.PlanetID(), EFIDX));
+	}
+
+	if (phase == Evaluation::SNIPE)
+	{
+		int range = 0;
+		for (unsigned int i = 0, n = sorted.size(); i < n; i++)
+			range = std::max(range, AP[sorted[i]].Distance(target));
+
+		inputs.push_back(-1);
+		GetStrengthInputs(tid, range, sorted, MFIDX, AP, AF, inputs);
+		inputs.push_back(-1);
+		GetStrengthInputs(tid, range, EPIDX, EFIDX, AP, AF, inputs);
+	}
+}
+
+// Runs the evaluations on the thread pool, or one after another without one.
+// Leaves the thread locals of the caller untouched.
+void Evaluate(EvaluationVec& evals) {
+	const PlanetVec* AP = bot::gAP;
+	const FleetVec*  AF = bot::gAF;
+	const int target    = bot::gTarget;
+	PlanCache* cache = PlanCache::Instance();
+	IntVec run; // the evaluations without a plan
+	for (unsigned int i = 0, n = evals.size(); i < n; i++)
+	{
+		Evaluation& e = evals[i];
+		e.orders.reserve(e.NTPIDX.size() + 1);
+		if (e.phase != Evaluation::ATTACK)
+		{
+			GetPlanInputs(e.phase, e.tid, e.enemyTime, e.NTPIDX, *e.context->AP, *e.context->AF, *e.context->EPIDX,
+				*e.context->EFIDX, *e.context->MFIDX, e.inputs);
+			e.cached = cache->Find(e.phase, e.tid, e.inputs, e.success, e.orders);
+		}
+		if (!e.cached)
+			run.push_back(i);
+	}
+
+	if (gPool == NULL || run.size() < 2)
+	{
+		for (unsigned int i = 0, n = run.size(); i < n; i++)
+			evals[run[i]].Run(0);
+	}
+	else
+	{
+		for (unsigned int i = 0, n = run.size(); i < n; i++)
+			gPool->Submit(&evals[run[i]]);
+		gPool->Wait();
+	}
+
+	// a defend that fails keeps failing while its inputs stay the same, it
+	// only gets less time. A snipe thought out ahead is left out, it would
+	// pass for a verdict of the turn it was made for.
+	for (unsigned int i = 0, n = run.size(); i < n; i++)
+	{
+		const Evaluation& e = evals[run[i]];
+		if (!e.ran)
+			continue;
+		if (e.phase == Evaluation::DEFEND || (e.phase == Evaluation::SNIPE && e.context->ponder == NULL))
+			cache->Store(e.phase, e.tid, e.inputs, e.success, e.orders, e.phase == Evaluation::DEFEND && !e.success);
+	}
+	bot::gAP     = AP;
+	bot::gAF     = AF;
+	bot::gTarget = target;
+}
+
+// apply orders found on a private copy of the state to the real state
+void Apply(FleetVec& orders, PlanetVec& AP, FleetVec& AF) {
 	for (unsigned int i = 0, n = orders.size(); i < n; i++)
 	{
-		Fleet& order = orders[i];
+		Planet& source = AP[orders[i].SourcePlanet()];
+		source.Backup();
+		source.RemoveShips(orders[i].NumShips());
+		AF.push_back(orders[i]);
+	}
+}
+
+// Sends the ships to spare of the sources to the targets at the least total
+// distance, as a min cost flow. A target is planned at the earliest turn the
+// sources that arrive by then can cover what it has at that turn, it gets
+// all those ships or none. While the ships do not cover all targets the
+// least preferred target that falls short is dropped. The orders are
+// applied, a target the simulation does not see captured gets its ships
+// back. Returns the number of captured targets.
+int Allocate(IntVec& targets, IntVec& sources, IntVec& numShipsToSpare,
+				PlanetVec& AP, FleetVec& AF, IntVec& EFIDX, FleetVec& orders) {
+	Simulator sim;
+	IntVec supply;
+	IntVec index(AP.size(), -1); // of a source in sources
+	for (unsigned int i = 0, n = sources.size(); i < n; i++)
+	{
+		const int sid = sources[i];
+		index[sid] = i;
+		const int numShips = std::min<int>(numShipsToSpare[sid], AP[sid].NumShips() - bot::GetIncommingFleets(sid, EFIDX));
+		supply.push_back(std::max(0, numShips));
+	}
+
+	// the first arrival at which the ships arriving by then cover the
+	// target, nothing when the target is ours by then
+	IntVec wanted, demand, horizon;
+	IntVec byDistance(sources.begin(), sources.end());
+	for (unsigned int i = 0, n = targets.size(); i < n; i++)
+	{
+		const int tid = targets[i];
+		bot::gTarget = tid;
+		sort(byDistance.begin(), byDistance.end(), bot::SortOnDistanceToTarget);
+
+		int numShips = 0, dist = 0, available = 0;
+		bool mine = false;
+		for (unsigned int j = 0, m = byDistance.size(); j < m && !mine; j++)
+		{
+			const int sid = byDistance[j];
+			const int k = index[sid];
+			if (supply[k] <= 0)
+				continue;
+
+			// the sources at the same distance arrive together, the next
+			// one with ships decides whether this one ends the group
+			available += supply[k];
+			dist = AP[sid].Distance(AP[tid]);
+			unsigned int next = j + 1;
+			while (next < m && supply[index[byDistance[next]]] <= 0)
+				next++;
+			if (next < m && AP[byDistance[next]].Distance(AP[tid]) == dist)
+				continue;
+
+			sim.StartPlanet(dist, AP, AF, tid);
+			mine = sim.IsMyPlanet(tid);
+			numShips = sim.GetPlanet(tid).NumShips() + 1;
+			if (numShips <= available)
+				break;
+		}
+		if (mine || dist == 0)
+			continue;
+
+		wanted.push_back(tid);
+		demand.push_back(numShips);
+		horizon.push_back(dist);
+	}
+
+	Route(sources, supply, wanted, demand, horizon, AP, orders);
+	Apply(orders, AP, AF);
+	FleetVec captured;
+	int numCaptured = 0;
+	for (unsigned int i = 0, n = wanted.size(); i < n; i++)
+	{
+		const int tid = wanted[i];
+		int dist = 0;
+		for (unsigned int j = 0, m = orders.size(); j < m; j++)
+			if (orders[j].DestinationPlanet() == tid)
+				dist = std::max(dist, orders[j].TurnsRemaining());
+
+		sim.StartPlanet(dist, AP, AF, tid);
+		const bool success = sim.IsMyPlanet(tid);
+		numCaptured += success;
+		for (unsigned int j = 0, m = orders.size(); j < m; j++)
+		{
+			const Fleet& order = orders[j];
+			if (order.DestinationPlanet() != tid)
+				continue;
+
+			if (success)
+			{
+				numShipsToSpare[order.SourcePlanet()] -= order.NumShips();
+				captured.push_back(order);
+			}
+			else
+			{
+				AP[order.SourcePlanet()].AddShips(order.NumShips());
+			}
+		}
+	}
+
+	// the fleets of the targets given up are taken back
+	AF.erase(AF.begin() + AF.size() - orders.size(), AF.end());
+	AF.insert(AF.end(), captured.begin(), captured.end());
+	orders = captured;
+	return numCaptured;
+}
+
+void IssueOrders(FleetVec& orders) {
+	gIssued->insert(gIssued->end(), orders.begin(), orders.end());
+	orders.clear();
+}
+
+// checks the orders of the turn on the state they were given for and
+// records them, sending them is left to the caller
+void RecordOrders(const PlanetVec& AP, const FleetVec& orders) {
+	for (unsigned int i = 0, n = orders.size(); i < n; i++)
+	{
+		const Fleet& order = orders[i];
 		const int sid = order.SourcePlanet();
 		const int numships = order.NumShips();
 		const int tid = order.DestinationPlanet();
 
 		ASSERT_MSG(numships > 0, order);
-		ASSERT_MSG(bot::gAP->at(sid).Owner() == 1, order);
+		ASSERT_MSG(AP[sid].Owner() == 1, order);
 		ASSERT_MSG(tid >= 0 && tid != sid, order);
-		gPW->IssueOrder(sid, tid, numships);
+		Counters::Add(Counters::ORDERS);
+		FlightRecorder::Order(order);
+		if (gTrace != NULL)
+			gTrace->Order(order);
 	}
-	orders.clear();
 }
 
-void DoTurn(PlanetWars& pw) {
-	std::vector<Planet> AP = pw.Planets();
-	std::vector<Fleet>  AF = pw.Fleets();
-	gPW                    = &pw;
+// The orders of a turn on the state AP, AF, which are worked on, with the
+// changes since the state of the last turn when known. The timer was
+// started when the state arrived. When pondering the search is left out,
+// only the caches see the work, and the orders stop at the step where the
+// real turn wanted to start.
+void Think(PlanetVec& AP, FleetVec& AF, const PlanetWars::ChangeSet* changes, Timer& timer, FleetVec& issued,
+	const Ponder* ponder) {
 	bot::gAP               = &AP; // all planets
 	bot::gAF               = &AF; // all fleets
-	std::vector<int> NPIDX;  // neutral planets
-	std::vector<int> EPIDX;  // enemy planets
-	std::vector<int> TPIDX;  // targetted planets belonging to us
-	std::vector<int> NTPIDX; // not targetted planets belonging to us
-	std::vector<int> EFIDX;  // enemy fleets
-	std::vector<int> MFIDX;  // my fleets
+	Router::Instance()->Update(AP);
+	MapCache::Instance()->Update(AP, *Router::Instance());
+	PlanCache::Instance()->Update(AP, turn);
+	const SimBase base(AF, AP.size()); // the orders of the turn are added to AF
+	SimBase::Scope bind(&base, AF);
+	IntVec NPIDX;  // neutral planets
+	IntVec EPIDX;  // enemy planets
+	IntVec TPIDX;  // targetted planets belonging to us
+	IntVec NTPIDX; // not targetted planets belonging to us
+	IntVec EFIDX;  // enemy fleets
+	IntVec MFIDX;  // my fleets
+	gIssued = &issued;
+
+	PlanetVec SAP; // untouched state for the search
+	FleetVec  SAF;
+	if ((SEARCH || MONTE_CARLO || ENDGAME) && !ponder)
+	{
+		SAP = AP;
+		SAF = AF;
+	}
+
+	// the projection to the end of the game carries over to the next turn,
+	// a guess of it when pondering does not
+	Timeline guess;
+	Timeline& timeline = ponder? guess: *Timeline::Instance();
+	timeline.Update(AP, AF, turn, MAX_TURNS, ponder? NULL: changes);
 
 	Simulator end, sim;
 #ifdef DEBUG
-	sim.Start(0, AP, AF, false, true);
+	sim.StartScore(0, AP, AF);
 	LOG("SCORE: "<<sim.GetScore());
+	end.Start(MAX_TURNS-turn, AP, AF, false, true); // the timeline is the same
+	for (unsigned int i = 0, n = AP.size(); i < n; i++)
+	{
+		ASSERT_MSG(end.GetPlanet(i).Owner() == timeline.GetOwner(i) &&
+			end.GetPlanet(i).NumShips() == timeline.GetNumShips(i), "Timeline of planet " << AP[i] <<
+			" ends as " << timeline.GetOwner(i) << "/" << timeline.GetNumShips(i));
+		ASSERT_MSG(!end.IsEnemyPlanet(i) ||
+			end.GetFirstEnemyOwner(i).time == timeline.GetFirstEnemyOwner(AP, i).time, "Timeline of planet " << AP[i]);
+	}
 #endif
-	end.Start(MAX_TURNS-turn, AP, AF, false, true);
 
 	vec3<double> mAvgLoc(0.0, 0.0, 0.0);
 	vec3<double> eAvgLoc(0.0, 0.0, 0.0);
@@ -169,13 +694,13 @@ void DoTurn(PlanetWars& pw) {
 		{
 			case 0: 
 			{
-				if (!end.IsMyPlanet(pid) && p.GrowthRate() > 0)
+				if (!timeline.IsMyPlanet(pid) && p.GrowthRate() > 0)
 					NPIDX.push_back(pid);
 			} break;
 
 			case 1: 
 			{
-				if (end.IsEnemyPlanet(pid))
+				if (timeline.IsEnemyPlanet(pid))
 					TPIDX.push_back(pid);
 				else
 					NTPIDX.push_back(pid);
@@ -201,124 +726,122 @@ void DoTurn(PlanetWars& pw) {
 			EFIDX.push_back(i);
 	}
 	Map map(AP);
-	std::vector<int>& FLPIDX = map.GetFrontLine();
-	std::vector<Fleet> orders;
+	IntVec& FLPIDX = map.GetFrontLine();
+	FleetVec orders;
+
+	if (Aborted(ponder))
+		return;
 
 	// ---------------------------------------------------------------------------
-	LOG("SNIPE"); // overtake neutral planets captured by the enemy
+	PHASE("SNIPE"); // overtake neutral planets captured by the enemy
 	// ---------------------------------------------------------------------------
+	// the snipes are checked in parallel from the same state, the results hold
+	// up to the first snipe that is taken, the remaining targets are checked
+	// again on the new state
+	Context context = {turn, &AP, &AF, &EPIDX, &EFIDX, &MFIDX, &map, &base, ponder};
+	IntVec SPIDX;
 	for (unsigned int i = 0, n = NPIDX.size(); i < n; i++)
 	{
-		Planet& target = AP[NPIDX[i]];
-		const int tid = target.PlanetID();
-		if (end.IsEnemyPlanet(tid))
+		if (timeline.IsEnemyPlanet(NPIDX[i]))
+			SPIDX.push_back(NPIDX[i]);
+	}
+	for (unsigned int i = 0, n = SPIDX.size(); i < n;)
+	{
+		EvaluationVec evals;
+		IntVec sources(NTPIDX);
+		for (unsigned int j = i; j < n; j++)
 		{
-			Simulator::PlanetOwner& enemy = end.GetFirstEnemyOwner(tid);
+			const int tid = SPIDX[j];
+			evals.push_back(Evaluation(&context, Evaluation::SNIPE, -1, tid, timeline.GetFirstEnemyOwner(AP, tid).time, sources));
 			bot::gTarget = tid;
-			sort(NTPIDX.begin(), NTPIDX.end(), bot::SortOnDistanceToTarget);
-			bool success = false;
-			for (unsigned int j = 0, m = NTPIDX.size(); j < m; j++)
-			{
-				Planet& source = AP[NTPIDX[j]];
-				const int sid = source.PlanetID();
-				const int dist = target.Distance(source);
-
-				// not enough ships
-				if (source.NumShips() <= 0)
-					continue;
-
-				sim.Start(dist, AP, AF, false, true);
-				int numShips =
-					std::min<int>(source.NumShips()-bot::GetIncommingFleets(sid,
-					EFIDX), sim.GetPlanet(tid).NumShips() + 1);
-
-
-				// we don't wanna be sniped, just wait
-				if (dist <= enemy.time)
-				{
-					break;
-				}
-
-				// only snipe when we are locally stronger or equal and the timedelay = 1
-				if (dist > enemy.time+1 && bot::GetStrength(tid, dist, NTPIDX, MFIDX) < bot::GetStrength(tid, dist, EPIDX, EFIDX))
-					continue;
+			sort(sources.begin(), sources.end(), bot::SortOnDistanceToTarget);
+		}
+		Evaluate(evals);
+		if (Aborted(ponder))
+			return;
 
-				if (numShips > 0)
-				{
-					Fleet order(1, numShips, sid, tid, dist, dist);
-					orders.push_back(order);
-					AF.push_back(order);
-					source.Backup();
-					source.RemoveShips(numShips);
-
-					sim.Start(dist, AP, AF, false, true);
-					if (sim.IsMyPlanet(tid))
-					{
-						success = true;
-						break;
-					}
-				}
-			}
-			if (success)
-			{
-				IssueOrders(orders);
-			}
-			else
+		for (unsigned int j = 0, m = evals.size(); j < m; j++)
+		{
+			bot::gTarget = evals[j].tid;
+			sort(NTPIDX.begin(), NTPIDX.end(), bot::SortOnDistanceToTarget);
+			i++;
+			if (evals[j].success)
 			{
-				for (unsigned int j = 0, m = orders.size(); j < m; j++)
-					AP[orders[j].SourcePlanet()].Restore();
-
-				AF.erase(AF.begin() + AF.size() - orders.size(), AF.end());
-				orders.clear();
+				Apply(evals[j].orders, AP, AF);
+				IssueOrders(evals[j].orders);
+				break;
 			}
 		}
 	}
 
+	if (Aborted(ponder))
+		return;
+
 	// ---------------------------------------------------------------------------
-	LOG("DEFEND AND ATTACK"); // sort planets on growthrate and perform attack
+	PHASE("DEFEND AND ATTACK"); // sort planets on growthrate and perform attack
 	// ---------------------------------------------------------------------------
 	// gather all planets that are under attack and we can defend
-	std::vector<int> DAPIDX;
-	for (unsigned int i = 0, n = TPIDX.size(); i < n; i++)
+	IntVec DAPIDX;
+	PlanetSet DAP(AP.size()); // the same as a set
 	{
-		Planet& target = AP[TPIDX[i]];
-		const int tid = target.PlanetID();
-		if (Defend(tid, AP, AF, NTPIDX, EFIDX, orders, true))
+		EvaluationVec evals;
+		for (unsigned int i = 0, n = TPIDX.size(); i < n; i++)
+		{
+			const int tid = TPIDX[i];
+			evals.push_back(Evaluation(&context, Evaluation::DEFEND, -1, tid, 0, NTPIDX));
+			bot::gTarget = tid;
+			sort(NTPIDX.begin(), NTPIDX.end(), bot::SortOnDistanceToTarget);
+		}
+		Evaluate(evals);
+		if (Aborted(ponder))
+			return;
+
+		for (unsigned int i = 0, n = evals.size(); i < n; i++)
 		{
-			DAPIDX.push_back(tid);
+			if (evals[i].success)
+			{
+				DAPIDX.push_back(evals[i].tid);
+				DAP.Add(evals[i].tid);
+			}
 		}
 	}
 
 	// gather all enemy planets that we can attack and that are weak, each
-	// frontline ship gets assigned an enemy planet (they may overlap)
-	std::map<int,int> targets;
+	// frontline ship gets assigned an enemy planet (they may overlap). The
+	// attacks are checked in parallel against the targets picked with the
+	// defended planets only, a source whose pick changes because of the
+	// targets of the sources before it is checked again. The strength around
+	// the enemy planets is summed up once for all sources, the checks restore
+	// the state.
+	IntVec targets(AP.size(), -1); // the source attacking a planet
 	if (!EPIDX.empty())
 	{
+		const Strength strength(AP, AF, EPIDX, EPIDX, EFIDX);
+		EvaluationVec evals;
 		for (unsigned int i = 0, n = FLPIDX.size(); i < n; i++)
 		{
-			Planet& source = AP[FLPIDX[i]];
-			const int sid = source.PlanetID();
-			int weakest = std::numeric_limits<int>::max();
-			int bestTarget = -1;
-			for (unsigned int j = 0, m = EPIDX.size(); j < m; j++)
-			{
-				Planet& target = AP[EPIDX[j]];
-				const int tid = target.PlanetID();
-				if (find(DAPIDX.begin(), DAPIDX.end(), tid) != DAPIDX.end())
-					continue;
-
-				const int dist = target.Distance(source);
-				int strength = bot::GetStrength(tid, dist, EPIDX, EFIDX) + target.NumShips();
-				if (strength < weakest)
-				{
-					weakest = strength;
-					bestTarget = tid;
-				}
-			}
-			if (bestTarget != -1 && Attack(map, EPIDX, sid, bestTarget, AP, AF, EFIDX, orders, true))
+			const int sid = FLPIDX[i];
+			const int tid = strength.Weakest(sid, &DAP);
+			if (tid != -1)
+				evals.push_back(Evaluation(&context, Evaluation::ATTACK, sid, tid, 0, IntVec()));
+		}
+		Evaluate(evals);
+		if (Aborted(ponder))
+			return;
+
+		for (unsigned int i = 0, n = evals.size(); i < n; i++)
+		{
+			const int sid = evals[i].sid;
+			const int tid = strength.Weakest(sid, &DAP);
+			bool success = evals[i].success;
+			if (tid != evals[i].tid)
+				success = tid != -1 && Attack(map, EPIDX, sid, tid, AP, AF, EFIDX, orders, true);
+
+			if (success)
 			{
-				targets[bestTarget] = sid;
-				DAPIDX.push_back(bestTarget);
+				targets[tid] = sid;
+				DAPIDX.push_back(tid);
+				DAP.Add(tid);
 			}
 		}
 	}
@@ -331,7 +854,23 @@ void DoTurn(PlanetWars& pw) {
 		const int tid = target.PlanetID();
 		if (target.Owner() <= 1)
 		{
-			if (Defend(tid, AP, AF, NTPIDX, EFIDX, orders, false))
+			// the check above when nothing it reads changed since
+			IntVec inputs;
+			GetPlanInputs(Evaluation::DEFEND, tid, 0, NTPIDX, AP, AF, EPIDX, EFIDX, MFIDX, inputs);
+			bool success = false;
+			if (PlanCache::Instance()->Find(Evaluation::DEFEND, tid, inputs, success, orders))
+			{
+				bot::gTarget = tid;
+				sort(NTPIDX.begin(), NTPIDX.end(), bot::SortOnDistanceToTarget);
+				Apply(orders, AP, AF);
+			}
+			else
+			{
+				success = Defend(tid, AP, AF, NTPIDX, EFIDX, orders, false);
+				PlanCache::Instance()->Store(Evaluation::DEFEND, tid, inputs, success, orders, !success);
+			}
+
+			if (success)
 				IssueOrders(orders);
 			else
 				break;
@@ -345,15 +884,18 @@ void DoTurn(PlanetWars& pw) {
 		}
 	}
 
+	if (Aborted(ponder))
+		return;
+
 	// ---------------------------------------------------------------------------
-	LOG("EXPAND"); // capture neutrals when we are losing or drawing
+	PHASE("EXPAND"); // capture neutrals when we are losing or drawing
 	// ---------------------------------------------------------------------------
-	end.Start(MAX_TURNS-turn, AP, AF, false, true);
+	end.StartScore(MAX_TURNS-turn, AP, AF);
 	if (end.GetScore() <= 0)
 	{
 		// 1. Compute the ships to spare wrt closest enemy
-		std::map<int, int> numShipsToSpare;
-		std::vector<int> MHPIDX; // planets that have ships to spare
+		IntVec numShipsToSpare(AP.size(), 0);
+		IntVec MHPIDX; // planets that have ships to spare
 		vec3<double> avgLoc(0.0,0.0,0.0);
 		int totalNumShipsToSpare = 0;
 		for (unsigned int i = 0, n = NTPIDX.size(); i < n; i++)
@@ -378,14 +920,14 @@ void DoTurn(PlanetWars& pw) {
 		avgLoc /= MHPIDX.size();
 
 		// 2. Filter out candidates wrt numships and enemy
-		std::vector<int> candidates;
+		IntVec candidates;
 		for (unsigned int i = 0, n = NPIDX.size(); i < n; i++)
 		{
 			Planet& target = AP[NPIDX[i]];
 			const int eid = map.GetClosestPlanetIdx(target.Loc(), EPIDX);
 			Planet& e = AP[eid];
 			const int edist2target = target.Distance(e);
-			std::vector<int> PIRIDX = map.GetPlanetIDsInRadius(target.Loc(), MHPIDX, edist2target);
+			IntVec PIRIDX = map.GetPlanetIDsInRadius(target.Loc(), MHPIDX, edist2target);
 			bot::gTarget = target.PlanetID();
 			sort(PIRIDX.begin(), PIRIDX.end(), bot::SortOnDistanceToTarget);
 			for (unsigned int j = 0, m = PIRIDX.size(); j < m; j++)
@@ -406,8 +948,8 @@ void DoTurn(PlanetWars& pw) {
 			}
 		}
 
-		std::vector<int> w; std::vector<double> v;
-		std::priority_queue<bot::NPV> PQ;
+		IntVec w; DoubleVec v;
+		std::priority_queue<bot::NPV, std::vector<bot::NPV, ArenaAllocator<bot::NPV> > > PQ;
 		for (unsigned int i = 0, n = candidates.size(); i < n; i++)
 		{
 			Planet& candidate = AP[candidates[i]];
@@ -425,9 +967,14 @@ void DoTurn(PlanetWars& pw) {
 			// way we can snipe those planets if the enemy captures them.
 			if (turn == 0)
 			{
-				KnapSack ks(w, v, totalNumShipsToSpare);
-				std::vector<int> I = ks.Indices();
-				std::vector<int> skip;
+				IntVec I;
+				if (!MapCache::Instance()->FindExpand(w, v, totalNumShipsToSpare, I))
+				{
+					KnapSack ks(w, v, totalNumShipsToSpare);
+					I = ks.Indices();
+					MapCache::Instance()->StoreExpand(w, v, totalNumShipsToSpare, I);
+				}
+				std::vector<bot::NPV, ArenaAllocator<bot::NPV> > selected;
 				for (unsigned int i = 0, n = I.size(); i < n; i++)
 				{
 					Planet& target = AP[candidates[I[i]]];
@@ -438,105 +985,30 @@ void DoTurn(PlanetWars& pw) {
 					Planet& enemy = AP[eid];
 					const int mdist = target.Distance(source);
 					const int edist = target.Distance(enemy);
-					if (mdist == edist)
-						skip.push_back(tid);
+					if (mdist != edist)
+						selected.push_back(bot::NPV(tid, v[I[i]]));
 				}
 
-				for (unsigned int i = 0, n = I.size(); i < n; i++)
-				{
-					Planet& target = AP[candidates[I[i]]];
-					const int tid = target.PlanetID();
-					if (find(skip.begin(), skip.end(), tid) != skip.end())
-						continue;
-
-					bool success = true;
-					bot::gTarget = tid;
-					sort(MHPIDX.begin(), MHPIDX.end(), bot::SortOnDistanceToTarget);
-					for (unsigned int j = 0, m = MHPIDX.size(); j < m; j++)
-					{
-						Planet& source = AP[MHPIDX[j]];
-						const int sid = source.PlanetID();
-						const int dist = target.Distance(source);
-						int numShips = std::min<int>(target.NumShips() + 1, numShipsToSpare[sid]);
-						numShips = std::min<int>(numShips, source.NumShips() - bot::GetIncommingFleets(sid, EFIDX));
-						if (numShips <= 0 || source.NumShips() <= 0)
-							continue;
-
-						sim.Start(dist, AP, AF, false, true);
-						numShips = std::min<int>(sim.GetPlanet(tid).NumShips() + 1, numShips);
-						numShipsToSpare[sid] -= numShips;
-						Fleet order(1, numShips, sid, tid, dist, dist);
-						orders.push_back(order);
-						AF.push_back(order);
-						source.Backup();
-						source.RemoveShips(numShips);
-						sim.Start(dist, AP, AF, false, true);
-
-						if (sim.IsMyPlanet(tid))
-						{
-							success = true;
-							break;
-						}
-					}
-					if (success)
-					{
-						IssueOrders(orders);
-					}
-					else
-					{
-						for (unsigned int j = 0, m = orders.size(); j < m; j++)
-							AP[orders[j].SourcePlanet()].Restore();
-
-						AF.erase(AF.begin() + AF.size() - orders.size(), AF.end());
-						orders.clear();
-					}
-				}
+				// all selected targets at once, the most valuable first
+				sort(selected.rbegin(), selected.rend());
+				IntVec targets;
+				for (unsigned int i = 0, n = selected.size(); i < n; i++)
+					targets.push_back(selected[i].id);
+				Allocate(targets, MHPIDX, numShipsToSpare, AP, AF, EFIDX, orders);
+				IssueOrders(orders);
 			}
 
 			// otherwise cap the best neutral if possible
 			else
 			{
 				Planet& target = AP[PQ.top().id];
-				const int tid = target.PlanetID();
-				bool success = false;
-				bot::gTarget = tid;
-				sort(MHPIDX.begin(), MHPIDX.end(), bot::SortOnDistanceToTarget);
-				for (unsigned int i = 0, n = MHPIDX.size(); i < n; i++)
-				{
-					Planet& source = AP[MHPIDX[i]];
-					const int sid = source.PlanetID();
-					const int dist = target.Distance(source);
-					sim.Start(dist, AP, AF, false, true);
-					int numShips = std::min<int>(sim.GetPlanet(tid).NumShips() + 1, numShipsToSpare[sid]);
-					numShips = std::min<int>(numShips, source.NumShips() - bot::GetIncommingFleets(sid, EFIDX));
-					if (numShips <= 0)
-						continue;
-
-					Fleet order(1, numShips, sid, tid, dist, dist);
-					orders.push_back(order);
-					AF.push_back(order);
-					source.Backup();
-					source.RemoveShips(numShips);
-					sim.Start(dist, AP, AF, false, true);
-
-					if (sim.IsMyPlanet(tid))
-					{
-						success = true;
-						break;
-					}
-				}
-				if (success)
+				IntVec targets(1, target.PlanetID());
+				if (Allocate(targets, MHPIDX, numShipsToSpare, AP, AF, EFIDX, orders) > 0)
 				{
 					IssueOrders(orders);
 				}
 				else
 				{
-					for (unsigned int j = 0, m = orders.size(); j < m; j++)
-						AP[orders[j].SourcePlanet()].Restore();
-
-					AF.erase(AF.begin() + AF.size() - orders.size(), AF.end());
-					orders.clear();
-
 					// "Lock" the closest planet to the best neutral
 					int sid = map.GetClosestPlanetIdx(target.Loc(), MHPIDX);
 					AP[sid].NumShips(0);
@@ -545,22 +1017,25 @@ void DoTurn(PlanetWars& pw) {
 		}
 	}
 
+	if (Aborted(ponder))
+		return;
+
 	// ---------------------------------------------------------------------------
-	LOG("FEED"); // support the frontline through routing
+	PHASE("FEED"); // support the frontline through routing
 	// ---------------------------------------------------------------------------
 	// compute the future frontline and use all non target planets for feeding this
 	// frontline
-	std::vector<Planet> AFP(AP); // all future planets
-	std::vector<Fleet>  AFF(AF); // all future fleets
+	PlanetVec AFP(AP); // all future planets
+	FleetVec  AFF(AF); // all future fleets
 	end.Start(MAX_TURNS-turn, AFP, AFF);
 	Map fmap(AFP); // future map, to compute future frontline
-	std::vector<int>& FFLPIDX = fmap.GetFrontLine();
+	IntVec& FFLPIDX = fmap.GetFrontLine();
 
 	for (unsigned int i = 0, n = NTPIDX.size(); i < n; i++)
 	{
 		Planet& source = AP[NTPIDX[i]];
 		const int sid = source.PlanetID();
-		if (find(FFLPIDX.begin(), FFLPIDX.end(), sid) != FFLPIDX.end())
+		if (fmap.IsFrontLine(sid))
 			continue;
 
 		const int tid = map.GetClosestPlanetIdx(source.Loc(), FFLPIDX);
@@ -573,29 +1048,107 @@ void DoTurn(PlanetWars& pw) {
 		if (numShips <= 0)
 			continue;
 
-		const int hid = bot::GetHub(sid, tid);
+		const int hid = Router::Instance()->NextHop(sid, tid);
+		ASSERT(hid == Router::Instance()->GetHub(AP, sid, tid));
 		Fleet order(1, numShips, sid, hid, dist, dist);
 		AF.push_back(order);
 		orders.push_back(order);
 		source.RemoveShips(numShips);
 	}
 	IssueOrders(orders);
+
+	// ---------------------------------------------------------------------------
+	PHASE("SEARCH"); // look ahead to improve on the greedy orders
+	// ---------------------------------------------------------------------------
+	if (ENDGAME && !ponder && Endgame::Small(SAP, SAF, MAX_TURNS-turn))
+	{
+		Endgame endgame(MAX_TURNS-turn, timer, TURN_TIME*SEARCH_TIME);
+		FleetVec best;
+		if (endgame.Run(SAP, SAF, issued, best))
+			issued = best;
+		LOG("endgame depth: "<<endgame.Depth()<<" nodes: "<<endgame.Nodes()<<
+			" score: "<<endgame.Score()<<" solved: "<<endgame.Solved());
+	}
+	else
+	if (SEARCH && !ponder)
+	{
+		Search search(MAX_TURNS-turn, timer, TURN_TIME*SEARCH_TIME);
+		FleetVec best;
+		if (search.Run(SAP, SAF, issued, best))
+			issued = best;
+		LOG("depth: "<<search.Depth()<<" nodes: "<<search.Nodes()<<" score: "<<search.Score());
+	}
+	else
+	if (MONTE_CARLO && !ponder)
+	{
+		MCTS mcts(MAX_TURNS-turn, timer, TURN_TIME*SEARCH_TIME);
+		FleetVec best;
+		if (mcts.Run(*gPool, SAP, SAF, issued, best))
+			issued = best;
+		LOG("playouts: "<<mcts.Playouts()<<" threads: "<<gPool->NumThreads());
+	}
 }
 
-#ifdef DEBUG
-void SigHandler(int signum) {
-	Logger logger("crash.txt");
-	logger.Log(gPW->ToString());
-	signal(signum, SIG_DFL);
-	kill(getpid(), signum);
+// the orders for the state in pw, which is worked on, the timer was
+// started when the state arrived
+void DoTurn(PlanetWars& pw, Timer& timer, FleetVec& orders) {
+	Think(pw.Planets(), pw.Fleets(), &pw.Changes(), timer, orders, NULL);
+	RecordOrders(pw.Planets(), orders);
+	Timeline::Instance()->Sent(orders);
+}
+
+void DoTurn(PlanetWars& pw) {
+	Timer timer;
+	timer.Tick();
+	FleetVec orders;
+	DoTurn(pw, timer, orders);
+	for (unsigned int i = 0, n = orders.size(); i < n; i++)
+		pw.IssueOrder(orders[i].SourcePlanet(), orders[i].DestinationPlanet(), orders[i].NumShips());
+}
+
+// the turn the engine most likely sends next, the check verdicts land in
+// the plan cache
+void ThinkAhead(PlanetVec& AP, FleetVec& AF, const Ponder& ponder) {
+	LOG("PONDER turn: "<<turn);
+	Timer timer;
+	timer.Tick();
+	FleetVec issued;
+	Think(AP, AF, NULL, timer, issued, &ponder);
 }
-#endif
+
+#ifndef NO_MAIN // the bench and the library link DoTurn without it
 
 // This is just the main game loop that takes care of communicating with the
 // game engine for you. You don't have to understand or change the code below.
 int main(int argc, char *argv[]) {
-	(void) argc;
-	(void) argv;
+	int threads = ThreadPool::NumCores(); // --threads N, 1 keeps DoTurn serial
+	LogLevel level = LOG_DEBUG;           // --log basic leaves out the state dumps
+	bool search = false;
+	bool mcts   = false;
+	bool ponder = false;
+	bool endgame = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string(argv[i]) == "--search")
+			search = true;
+		if (std::string(argv[i]) == "--mcts")
+			mcts = true;
+		if (std::string(argv[i]) == "--endgame")
+			endgame = true;
+		if (std::string(argv[i]) == "--threads" && i+1 < argc)
+			threads = std::max(1, atoi(argv[++i]));
+		if (std::string(argv[i]) == "--log" && i+1 < argc)
+			level = (std::string(argv[++i]) == "basic")? LOG_BASIC: LOG_DEBUG;
+		if (std::string(argv[i]) == "--trace" && i+1 < argc)
+			gTrace = new TraceWriter(argv[++i]);
+		if (std::string(argv[i]) == "--ponder")
+			ponder = true;
+		if (std::string(argv[i]) == "--counters" && i+1 < argc)
+			Counters::Open(argv[++i]); // the work per turn as JSON lines
+		if (std::string(argv[i]) == "--cache" && i+1 < argc)
+			MapCache::Open(argv[++i]); // the map tables from earlier games
+	}
+	FlightRecorder::Install("crash.txt");
 
 	#ifdef DEBUG
 	char buf[1024] = {0};
@@ -605,44 +1158,60 @@ int main(int argc, char *argv[]) {
 		"%s.txt",
 		argv[0]
 	);
-	signal(SIGSEGV, SigHandler);
 	Logger logger(buf);
+	logger.SetLevel(level);
 	Logger::SetLogger(&logger);
 	LOG(argv[0]<<" initialized");
 	#endif
 
-	std::string current_line;
+	Bot bot(threads, search, mcts, ponder, endgame);
+	PlanetWars& pw = bot.State();
+	Reader* reader = ponder? new Reader(pw): NULL; // parses on its own thread
 	std::string map_data;
-	while (true) {
-		int c = std::cin.get();
-		current_line += (char)c;
-		if (c == '\n') 
+	while ((reader != NULL)? reader->Next(): Reader::Read(std::cin, map_data))
+	{
+		Timer own; // the turn time counts from the arrival of the state
+		Timer& t = (reader != NULL)? reader->Arrived(): own;
+		if (reader == NULL)
 		{
-			if (current_line.length() >= 2 && current_line.substr(0, 2) == "go") 
-			{
-				PlanetWars pw(map_data);
-				map_data = "";
-				LOG("turn: " << turn);
-				LOG(pw.ToString());
-				#ifdef DEBUG
-				Timer t;
-				t.Tick();
-				#endif
-				DoTurn(pw);
-				#ifdef DEBUG
-				t.Tock();
-				LOG("TIME: "<<t.Time()<<"s");
-				#endif
-				LOG("\n--------------------------------------------------------------------------------\n");
-				turn++;
-				pw.FinishTurn();
-			} 
-			else 
-			{
-				map_data += current_line;
-			}
-			current_line = "";
+			t.Tick();
+			pw.Update(map_data);
 		}
+		const int turn = bot.Turn();
+		LOG("turn: " << turn);
+		LOG("CHANGES: new="<<pw.Changes().new_fleets.size()<<
+			" landed="<<pw.Changes().landed_fleets.size()<<
+			" flips="<<pw.Changes().owner_flips.size());
+		LOGD(pw.ToString());
+		FlightRecorder::BeginTurn(turn, pw.Planets(), pw.Fleets());
+		if (gTrace != NULL)
+			gTrace->BeginTurn(turn, pw.Planets(), pw.Fleets());
+		{
+			FleetVec orders;
+			bot.Play(t, orders);
+			for (unsigned int i = 0, n = orders.size(); i < n; i++)
+				pw.IssueOrder(orders[i].SourcePlanet(), orders[i].DestinationPlanet(), orders[i].NumShips());
+		}
+		t.Tock();
+		LOG("TIME: "<<t.Time()<<"s");
+		if (gTrace != NULL)
+			gTrace->EndTurn();
+		Counters::EndTurn(turn, t.Time());
+		LOG("COUNTERS: "<<Counters::Line(Counters::Turns() - 1));
+		LOG("PLANS: hits="<<PlanCache::Instance()->Hits()<<
+			" misses="<<PlanCache::Instance()->Misses());
+		LOG("ARENA: allocs="<<Arena::Instance()->NumAllocs()<<
+			" bytes="<<Arena::Instance()->NumBytes()<<
+			" mallocs="<<Arena::Instance()->NumSystemAllocs()<<
+			" capacity="<<Arena::Instance()->Capacity());
+		LOG("\n--------------------------------------------------------------------------------\n");
+		pw.FinishTurn();
+		bot.EndTurn();
+		if (reader != NULL)
+			reader->Done();
 	}
+	delete reader;
 	return 0;
 }
+
+#endif
@@ -0,0 +1,56 @@
+#include "PlanCache.h"
+
+#include <algorithm>
+
+PlanCache::PlanCache():
+	turn(0),
+	hits(0),
+	misses(0)
+{}
+
+__thread PlanCache* PlanCache::current = NULL;
+
+PlanCache* PlanCache::Instance() {
+	static PlanCache cache;
+	return (current != NULL)? current: &cache;
+}
+
+void PlanCache::Update(const PlanetVec& AP, int t) {
+	turn = t;
+	hits = misses = 0;
+	bool same = locations.size() == AP.size();
+	for (unsigned int i = 0, n = AP.size(); i < n && same; i++)
+		same = locations[i] == AP[i].Loc();
+	if (same)
+		return;
+
+	plans.clear();
+	locations.clear();
+	for (unsigned int i = 0, n = AP.size(); i < n; i++)
+		locations.push_back(AP[i].Loc());
+}
+
+bool PlanCache::Find(int phase, int tid, const IntVec& inputs, bool& success, FleetVec& orders) {
+	std::map<std::pair<int, int>, Plan>::const_iterator i = plans.find(std::make_pair(phase, tid));
+	if (i == plans.end() || (i->second.turn != turn && !i->second.keep) ||
+		i->second.inputs.size() != inputs.size() ||
+		!std::equal(inputs.begin(), inputs.end(), i->second.inputs.begin()))
+	{
+		misses++;
+		return false;
+	}
+
+	hits++;
+	success = i->second.success;
+	orders.assign(i->second.orders.begin(), i->second.orders.end());
+	return true;
+}
+
+void PlanCache::Store(int phase, int tid, const IntVec& inputs, bool success, const FleetVec& orders, bool keep) {
+	Plan& plan = plans[std::make_pair(phase, tid)];
+	plan.inputs.assign(inputs.begin(), inputs.end());
+	plan.success = success;
+	plan.turn    = turn;
+	plan.keep    = keep;
+	plan.orders.assign(orders.begin(), orders.end());
+}
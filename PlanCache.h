@@ -0,0 +1,53 @@
+#ifndef PLANCACHE_
+#define PLANCACHE_
+
+#include "PlanetWars.h"
+
+#include <map>
+#include <utility>
+#include <vector>
+
+// Verdicts of the per target checks of DoTurn, kept per phase and target
+// with the inputs they were made from. A check whose inputs are the same as
+// the last time reuses the verdict and the orders instead of running again.
+// The caller writes the inputs, the cache only compares them. A verdict is
+// valid for the turn it was made in, unless it was stored to be kept. The
+// plans live for the game and are dropped on a different map.
+class PlanCache {
+public:
+	PlanCache();
+
+	// the cache of the game played on this thread, a shared one unless
+	// SetInstance gave the thread its own
+	static PlanCache* Instance();
+	static void       SetInstance(PlanCache* cache) { current = cache; }
+
+	// call at the start of a turn, starts over on a different map
+	void Update(const PlanetVec& AP, int turn);
+
+	// the verdict and orders of the last check of tid in phase, false when
+	// it was made from different inputs or is out of date
+	bool Find(int phase, int tid, const IntVec& inputs, bool& success, FleetVec& orders);
+	void Store(int phase, int tid, const IntVec& inputs, bool success, const FleetVec& orders, bool keep);
+
+	int Hits() const   { return hits; }
+	int Misses() const { return misses; }
+
+private:
+	struct Plan {
+		std::vector<int>   inputs;
+		bool               success;
+		int                turn; // made in
+		bool               keep; // valid in later turns
+		std::vector<Fleet> orders;
+	};
+
+	std::map<std::pair<int, int>, Plan> plans;
+	std::vector<vec3<double> >          locations;
+	int turn;
+	int hits, misses; // this turn
+
+	static __thread PlanCache* current;
+};
+
+#endif
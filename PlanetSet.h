@@ -0,0 +1,81 @@
+#ifndef PLANETSET_
+#define PLANETSET_
+
+#include "Arena.h"
+
+// Set of planet ids as a bitset sized to the map, a single word for the maps
+// of the game. Membership, insertion and the set algebra are word operations,
+// iteration goes in id order:
+//
+//   for (int pid = set.First(); pid != -1; pid = set.Next(pid))
+class PlanetSet {
+public:
+	explicit PlanetSet(int numPlanets = 0): words((numPlanets + 63) / 64, 0) {}
+
+	PlanetSet(int numPlanets, const IntVec& ids): words((numPlanets + 63) / 64, 0) {
+		for (unsigned int i = 0, n = ids.size(); i < n; i++)
+			Add(ids[i]);
+	}
+
+	bool Has(int id) const  { return (words[id >> 6] >> (id & 63)) & 1; }
+	void Add(int id)        { words[id >> 6] |= Word(1) << (id & 63); }
+	void Remove(int id)     { words[id >> 6] &= ~(Word(1) << (id & 63)); }
+
+	int Size() const {
+		int size = 0;
+		for (unsigned int i = 0, n = words.size(); i < n; i++)
+			size += __builtin_popcountll(words[i]);
+		return size;
+	}
+
+	bool Empty() const {
+		for (unsigned int i = 0, n = words.size(); i < n; i++)
+			if (words[i] != 0)
+				return false;
+		return true;
+	}
+
+	// both sets belong to the same map
+	PlanetSet& operator |= (const PlanetSet& s) {
+		for (unsigned int i = 0, n = words.size(); i < n; i++)
+			words[i] |= s.words[i];
+		return *this;
+	}
+
+	PlanetSet& operator &= (const PlanetSet& s) {
+		for (unsigned int i = 0, n = words.size(); i < n; i++)
+			words[i] &= s.words[i];
+		return *this;
+	}
+
+	PlanetSet& operator -= (const PlanetSet& s) {
+		for (unsigned int i = 0, n = words.size(); i < n; i++)
+			words[i] &= ~s.words[i];
+		return *this;
+	}
+
+	// the smallest id in the set, -1 when empty
+	int First() const { return From(0); }
+
+	// the smallest id in the set after id, -1 when there is none
+	int Next(int id) const { return From(id + 1); }
+
+private:
+	typedef unsigned long long Word;
+
+	std::vector<Word, ArenaAllocator<Word> > words;
+
+	int From(int id) const {
+		for (unsigned int i = id >> 6, n = words.size(); i < n; i++)
+		{
+			Word w = words[i];
+			if (i == (unsigned int)(id >> 6))
+				w &= ~Word(0) << (id & 63);
+			if (w != 0)
+				return i*64 + __builtin_ctzll(w);
+		}
+		return -1;
+	}
+};
+
+#endif
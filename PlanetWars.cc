@@ -1,8 +1,10 @@
 #include "PlanetWars.h"
 #include "Logger.h"
+#include "Counters.h"
 
 #include <cmath>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -41,6 +43,7 @@ Fleet::Fleet(int owner,
   destination_planet_ = destination_planet;
   total_trip_length_ = total_trip_length;
   turns_remaining_ = turns_remaining;
+  fleet_id_ = -1;
 }
 
 int Fleet::Owner() const {
@@ -115,6 +118,7 @@ vec3<double> Planet::Loc() const {
 }
 
 int Planet::Distance(const Planet& p) const {
+  Counters::Add(Counters::DISTANCES);
   return int(ceil((p.Loc() - location_).len2D()));
 }
 
@@ -156,15 +160,99 @@ void Planet::Restore() {
   num_ships_ = bak_num_ships_;
 }
 
-PlanetWars::PlanetWars(const std::string& gameState) {
-  ParseGameState(gameState);
+PlanetWars::PlanetWars():
+  planets_(ArenaAllocator<Planet>::Heap()),
+  fleets_(ArenaAllocator<Fleet>::Heap()),
+  scratch_planets_(ArenaAllocator<Planet>::Heap()),
+  scratch_fleets_(ArenaAllocator<Fleet>::Heap()),
+  num_parsed_fleets_(0),
+  next_fleet_id_(0) {
+  changes_.full = true;
+}
+
+PlanetWars::PlanetWars(const std::string& gameState):
+  planets_(ArenaAllocator<Planet>::Heap()),
+  fleets_(ArenaAllocator<Fleet>::Heap()),
+  scratch_planets_(ArenaAllocator<Planet>::Heap()),
+  scratch_fleets_(ArenaAllocator<Fleet>::Heap()),
+  num_parsed_fleets_(0),
+  next_fleet_id_(0) {
+  changes_.full = true;
+  Update(gameState);
+}
+
+int PlanetWars::Update(const std::string& gameState) {
+  bool full = planets_.empty();
+  int success = ParseGameState(gameState, full);
+  if (!success && !full) {
+    // the planet layout changed, start over
+    full = true;
+    success = ParseGameState(gameState, full);
+  }
+  if (!success) {
+    return 0;
+  }
+  changes_.full = full;
+  MatchFleets();
+  planets_.swap(scratch_planets_);
+  fleets_.swap(scratch_fleets_);
+  num_parsed_fleets_ = fleets_.size();
+  if (full) {
+    // both buffers carry the static planet data from now on
+    scratch_planets_ = planets_;
+  }
+  return 1;
+}
+
+const PlanetWars::ChangeSet& PlanetWars::Changes() const {
+  return changes_;
+}
+
+void PlanetWars::MatchFleets() {
+  changes_.new_fleets.clear();
+  changes_.landed_fleets.clear();
+  const unsigned int n = changes_.full ? 0 : num_parsed_fleets_;
+  matched_.assign(n, 0);
+  unsigned int cursor = 0;
+  for (unsigned int i = 0; i < scratch_fleets_.size(); ++i) {
+    Fleet& f = scratch_fleets_[i];
+    // The engine keeps fleets in launch order, so the match is nearly always
+    // found at the cursor.
+    int match = -1;
+    for (unsigned int k = 0; k < n && match == -1; ++k) {
+      const unsigned int j = (cursor + k) % n;
+      const Fleet& g = fleets_[j];
+      if (!matched_[j] &&
+          g.Owner() == f.Owner() &&
+          g.NumShips() == f.NumShips() &&
+          g.SourcePlanet() == f.SourcePlanet() &&
+          g.DestinationPlanet() == f.DestinationPlanet() &&
+          g.TotalTripLength() == f.TotalTripLength() &&
+          g.TurnsRemaining() == f.TurnsRemaining() + 1) {
+        match = j;
+      }
+    }
+    if (match != -1) {
+      matched_[match] = 1;
+      f.FleetID(fleets_[match].FleetID());
+      cursor = match + 1;
+    } else {
+      f.FleetID(next_fleet_id_++);
+      changes_.new_fleets.push_back(i);
+    }
+  }
+  for (unsigned int j = 0; j < n; ++j) {
+    if (!matched_[j]) {
+      changes_.landed_fleets.push_back(fleets_[j]);
+    }
+  }
 }
 
-std::vector<Planet>& PlanetWars::Planets() {
+PlanetVec& PlanetWars::Planets() {
   return planets_;
 }
 
-std::vector<Fleet>& PlanetWars::Fleets() {
+FleetVec& PlanetWars::Fleets() {
   return fleets_;
 }
 
@@ -190,56 +278,121 @@ void PlanetWars::IssueOrder(int source_planet,
   std::cout.flush();
 }
 
-int PlanetWars::ParseGameState(const std::string& s) {
-  planets_.clear();
-  fleets_.clear();
-  std::vector<std::string> lines = StringUtil::Tokenize(s, "\n");
+// Reads up to max whitespace separated numbers from [p, end) into out and
+// returns how many tokens were found.
+static int ParseNumbers(const char* p, const char* end, double* out, int max) {
+  int n = 0;
+  while (p < end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+      ++p;
+    }
+    if (p == end) {
+      break;
+    }
+    char* next;
+    double d = strtod(p, &next);
+    if (next == p || next > end) {
+      return -1;
+    }
+    if (n < max) {
+      out[n] = d;
+    }
+    ++n;
+    p = next;
+  }
+  return n;
+}
+
+// Skips n whitespace separated tokens.
+static const char* SkipTokens(const char* p, const char* end, int n) {
+  for (int i = 0; i < n; ++i) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+      ++p;
+    }
+    while (p < end && *p != ' ' && *p != '\t' && *p != '\r') {
+      ++p;
+    }
+  }
+  return p;
+}
+
+int PlanetWars::ParseGameState(const std::string& s, bool full) {
+  if (full) {
+    scratch_planets_.clear();
+  }
+  scratch_fleets_.clear();
+  changes_.owner_flips.clear();
+  const char* p = s.c_str();
+  const char* end = p + s.size();
   int planet_id = 0;
-  for (unsigned int i = 0; i < lines.size(); ++i) {
-    std::string& line = lines[i];
-    size_t comment_begin = line.find_first_of('#');
-    if (comment_begin != std::string::npos) {
-      line = line.substr(0, comment_begin);
+  double t[6];
+  while (p < end) {
+    const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+    if (eol == NULL) {
+      eol = end;
     }
-    std::vector<std::string> tokens = StringUtil::Tokenize(line);
-    if (tokens.size() == 0) {
-      continue;
+    const char* comment = static_cast<const char*>(memchr(p, '#', eol - p));
+    const char* line_end = comment != NULL ? comment : eol;
+    while (p < line_end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+      ++p;
     }
-    if (tokens[0] == "P") {
-      if (tokens.size() != 6) {
+    if (p < line_end) {
+      const char type = *p++;
+      if (p < line_end && *p != ' ' && *p != '\t') {
         return 0;
       }
-      Planet p(planet_id++,              // The ID of this planet
-	       atoi(tokens[3].c_str()),  // Owner
-               atoi(tokens[4].c_str()),  // Num ships
-               atoi(tokens[5].c_str()),  // Growth rate
-               atof(tokens[1].c_str()),  // X
-               atof(tokens[2].c_str())); // Y
-      planets_.push_back(p);
-    } else if (tokens[0] == "F") {
-      if (tokens.size() != 7) {
+      if (type == 'P' && !full) {
+        // coordinates never change, only owner, ships and growth are read
+        // and the growth rate is used to verify the layout
+        const unsigned int pid = planet_id++;
+        if (ParseNumbers(SkipTokens(p, line_end, 2), line_end, t, 3) != 3 ||
+            pid >= planets_.size() ||
+            static_cast<int>(t[2]) != planets_[pid].GrowthRate()) {
+          return 0;
+        }
+        Planet& planet = scratch_planets_[pid];
+        planet.Owner(static_cast<int>(t[0]));
+        planet.NumShips(static_cast<int>(t[1]));
+        if (planet.Owner() != planets_[pid].Owner()) {
+          changes_.owner_flips.push_back(pid);
+        }
+      } else if (type == 'P') {
+        if (ParseNumbers(p, line_end, t, 6) != 5) {
+          return 0;
+        }
+        Planet planet(planet_id++,              // The ID of this planet
+                      static_cast<int>(t[2]),   // Owner
+                      static_cast<int>(t[3]),   // Num ships
+                      static_cast<int>(t[4]),   // Growth rate
+                      t[0],                     // X
+                      t[1]);                    // Y
+        scratch_planets_.push_back(planet);
+      } else if (type == 'F') {
+        if (ParseNumbers(p, line_end, t, 6) != 6) {
+          return 0;
+        }
+        Fleet f(static_cast<int>(t[0]),  // Owner
+                static_cast<int>(t[1]),  // Num ships
+                static_cast<int>(t[2]),  // Source
+                static_cast<int>(t[3]),  // Destination
+                static_cast<int>(t[4]),  // Total trip length
+                static_cast<int>(t[5])); // Turns remaining
+        if (f.NumShips() > 0) {
+          scratch_fleets_.push_back(f);
+        }
+      } else {
         return 0;
       }
-      Fleet f(atoi(tokens[1].c_str()),  // Owner
-              atoi(tokens[2].c_str()),  // Num ships
-              atoi(tokens[3].c_str()),  // Source
-              atoi(tokens[4].c_str()),  // Destination
-              atoi(tokens[5].c_str()),  // Total trip length
-              atoi(tokens[6].c_str())); // Turns remaining
-	  if (f.NumShips() > 0)
-	  {
-        fleets_.push_back(f);
-	  }
-    } else {
-      return 0;
     }
+    p = eol + 1;
   }
-  return 1;
+  return full || static_cast<unsigned int>(planet_id) == planets_.size();
 }
 
 void PlanetWars::FinishTurn() const {
   std::cout << "go" << std::endl;
   std::cout.flush();
+  Arena::Instance()->Reset();
 }
 
 std::ostream& operator<<(std::ostream &out, const Planet& p) {
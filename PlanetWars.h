@@ -10,6 +10,7 @@
 #include <vector>
 
 #include "vec3.h"
+#include "Arena.h"
 
 // This is a utility class that parses strings.
 class StringUtil {
@@ -64,6 +65,12 @@ class Fleet {
   // Set a new value for turns remaining
   int TurnsRemaining(int new_turns_remaining);
 
+  // Returns the ID of this fleet. The ID stays the same for as long as the
+  // fleet is in flight, fleets that are not parsed from the game state
+  // (e.g. our own hypothetical orders) have ID -1.
+  int FleetID() const { return fleet_id_; }
+  void FleetID(int fleet_id) { fleet_id_ = fleet_id; }
+
   void Owner(int owner) { owner_ = owner; }
   void Backup();
   void Restore();
@@ -80,6 +87,7 @@ class Fleet {
   int destination_planet_;
   int total_trip_length_;
   int turns_remaining_;
+  int fleet_id_;
 };
 
 // Stores information about one planet. There is one instance of this class
@@ -146,17 +154,44 @@ class Planet {
   vec3<double> location_;
 };
 
+// Per-turn working copies of the planets and fleets, drawn from the arena
+typedef std::vector<Planet, ArenaAllocator<Planet> > PlanetVec;
+typedef std::vector<Fleet, ArenaAllocator<Fleet> >   FleetVec;
+
+// The game state is kept in two buffers that live for the whole game. A new
+// state is parsed in place into the scratch buffer, after which the buffers
+// are swapped. The current buffer is handed to DoTurn as its mutable working
+// copy, the scratch buffer holds the previous turn until it is overwritten.
 class PlanetWars {
  public:
   // Initializes the game state given a string containing game state data.
   PlanetWars(const std::string& game_state);
-  PlanetWars(){}
+  PlanetWars();
+
+  // What changed between the previous and the current game state, so caches
+  // can be invalidated precisely.
+  struct ChangeSet {
+    bool full;                        // static data was (re)parsed, nothing carries over
+    std::vector<int> new_fleets;      // indices in Fleets() of newly launched fleets
+    std::vector<Fleet> landed_fleets; // fleets of the previous turn that arrived
+    std::vector<int> owner_flips;     // planets that changed owner
+  };
+
+  // Parses a new game state into the scratch buffer and makes it current.
+  // After the first turn only the owners and ship counts of the planets are
+  // parsed and fleets are matched with the previous turn to keep their IDs.
+  // On success, returns 1. On failure, returns 0 and leaves the current state
+  // untouched.
+  int Update(const std::string& game_state);
+
+  // Returns the changes made by the last call to Update().
+  const ChangeSet& Changes() const;
 
   // Returns a list of all the planets.
-  std::vector<Planet>& Planets();
+  PlanetVec& Planets();
 
   // Return a list of all the fleets.
-  std::vector<Fleet>& Fleets();
+  FleetVec& Fleets();
 
   // Writes a string which represents the current game state. This string
   // conforms to the Point-in-Time format from the project Wiki.
@@ -172,18 +207,32 @@ class PlanetWars {
 		  int num_ships) const;
 
   // Sends a message to the game engine letting it know that you're done
-  // issuing orders for now.
+  // issuing orders for now. This also releases all per-turn arena memory.
   void FinishTurn() const;
 
  private:
-  // Parses a game state from a string. On success, returns 1. On failure,
-  // returns 0.
-  int ParseGameState(const std::string& s);
+  // Parses a game state from a string into the scratch buffer. When full is
+  // false the static planet data is taken from the current state. On success,
+  // returns 1. On failure, returns 0.
+  int ParseGameState(const std::string& s, bool full);
+
+  // Gives the fleets in the scratch buffer the ID of the fleet they continue
+  // from the current state, or a new one, and records the fleet changes.
+  void MatchFleets();
 
   // Store all the planets and fleets. OMG we wouldn't wanna lose all the
   // planets and fleets, would we!?
-  std::vector<Planet> planets_;
-  std::vector<Fleet> fleets_;
+  PlanetVec planets_;
+  FleetVec fleets_;
+
+  // Scratch buffers, the target of the next parse
+  PlanetVec scratch_planets_;
+  FleetVec scratch_fleets_;
+
+  ChangeSet changes_;
+  std::vector<char> matched_; // previous fleets matched during MatchFleets()
+  unsigned int num_parsed_fleets_; // fleets_ beyond this were added by DoTurn
+  int next_fleet_id_;
 };
 
 #endif
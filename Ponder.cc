@@ -0,0 +1,178 @@
+#include "Ponder.h"
+#include "Simulator.h"
+
+#include <iostream>
+#include <string>
+
+Ponder::Ponder(Think t, void* o):
+	think(t),
+	owner(o),
+	AP(ArenaAllocator<Planet>::Heap()),
+	AF(ArenaAllocator<Fleet>::Heap()),
+	orders(ArenaAllocator<Fleet>::Heap()),
+	pending(false),
+	busy(false),
+	abort(false),
+	quit(false)
+{
+	pthread_mutex_init(&lock, NULL);
+	pthread_cond_init(&wake, NULL);
+	pthread_cond_init(&idle, NULL);
+	pthread_create(&thread, NULL, Main, this);
+}
+
+Ponder::~Ponder() {
+	pthread_mutex_lock(&lock);
+	quit = true;
+	__atomic_store_n(&abort, true, __ATOMIC_RELEASE);
+	pthread_cond_signal(&wake);
+	pthread_mutex_unlock(&lock);
+	pthread_join(thread, NULL);
+	pthread_cond_destroy(&idle);
+	pthread_cond_destroy(&wake);
+	pthread_mutex_destroy(&lock);
+}
+
+void Ponder::BeginTurn(const PlanetVec& ap, const FleetVec& af) {
+	AP.assign(ap.begin(), ap.end());
+	AF.assign(af.begin(), af.end());
+	orders.clear();
+}
+
+void Ponder::Order(const Fleet& order) {
+	orders.push_back(order);
+}
+
+void Ponder::Start() {
+	Stop();
+	pthread_mutex_lock(&lock);
+	__atomic_store_n(&abort, false, __ATOMIC_RELEASE);
+	pending = true;
+	pthread_cond_signal(&wake);
+	pthread_mutex_unlock(&lock);
+}
+
+// a turn the thread did not take yet is dropped
+void Ponder::Stop() {
+	pthread_mutex_lock(&lock);
+	pending = false;
+	if (busy)
+		__atomic_store_n(&abort, true, __ATOMIC_RELEASE);
+	while (busy)
+		pthread_cond_wait(&idle, &lock);
+	pthread_mutex_unlock(&lock);
+}
+
+void* Ponder::Main(void* arg) {
+	Ponder* ponder = static_cast<Ponder*>(arg);
+	pthread_mutex_lock(&ponder->lock);
+	while (true)
+	{
+		while (!ponder->pending && !ponder->quit)
+			pthread_cond_wait(&ponder->wake, &ponder->lock);
+		if (ponder->quit)
+			break;
+
+		ponder->pending = false;
+		ponder->busy    = true;
+		pthread_mutex_unlock(&ponder->lock);
+		ponder->Run();
+		pthread_mutex_lock(&ponder->lock);
+		ponder->busy = false;
+		pthread_cond_broadcast(&ponder->idle);
+	}
+	pthread_mutex_unlock(&ponder->lock);
+	return NULL;
+}
+
+void Ponder::Run() {
+	for (unsigned int i = 0, n = orders.size(); i < n; i++)
+	{
+		const Fleet& order = orders[i];
+		AP[order.SourcePlanet()].RemoveShips(order.NumShips());
+		AF.push_back(order);
+	}
+
+	Simulator sim;
+	sim.Start(1, AP, AF);
+	think(owner, AP, AF);
+	Arena::Instance()->Reset();
+}
+
+Reader::Reader(PlanetWars& p):
+	pw(p),
+	head(0),
+	tail(0),
+	done(0)
+{
+	pthread_mutex_init(&lock, NULL);
+	pthread_cond_init(&changed, NULL);
+	pthread_create(&thread, NULL, Main, this);
+}
+
+Reader::~Reader() {
+	pthread_join(thread, NULL);
+	pthread_cond_destroy(&changed);
+	pthread_mutex_destroy(&lock);
+}
+
+bool Reader::Read(std::istream& in, std::string& state) {
+	std::string current_line;
+	state.clear();
+	while (true)
+	{
+		const int c = in.get();
+		if (c == EOF)
+			return false;
+		current_line += (char)c;
+		if (c == '\n')
+		{
+			if (current_line.length() >= 2 && current_line.substr(0, 2) == "go")
+				return true;
+			state += current_line;
+			current_line.clear();
+		}
+	}
+}
+
+bool Reader::Next() {
+	pthread_mutex_lock(&lock);
+	while (head == tail)
+		pthread_cond_wait(&changed, &lock);
+	const bool state = ring[tail & (RING_SIZE - 1)];
+	tail++;
+	pthread_mutex_unlock(&lock);
+	return state;
+}
+
+void Reader::Done() {
+	pthread_mutex_lock(&lock);
+	done++;
+	pthread_cond_signal(&changed);
+	pthread_mutex_unlock(&lock);
+}
+
+// pw is parsed outside the lock, the main thread is done with it by then
+void* Reader::Main(void* arg) {
+	Reader* reader = static_cast<Reader*>(arg);
+	std::string text;
+	bool state = true;
+	while (state)
+	{
+		state = Read(std::cin, text);
+		reader->arrived[reader->head & (RING_SIZE - 1)].Tick();
+		pthread_mutex_lock(&reader->lock);
+		while (reader->done != reader->head)
+			pthread_cond_wait(&reader->changed, &reader->lock);
+		pthread_mutex_unlock(&reader->lock);
+		if (state)
+			reader->pw.Update(text);
+
+		pthread_mutex_lock(&reader->lock);
+		reader->ring[reader->head & (RING_SIZE - 1)] = state;
+		reader->head++;
+		pthread_cond_signal(&reader->changed);
+		pthread_mutex_unlock(&reader->lock);
+	}
+	return NULL;
+}
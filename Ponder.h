@@ -0,0 +1,89 @@
+#ifndef PONDER_
+#define PONDER_
+
+#include "PlanetWars.h"
+#include "Timer.h"
+
+#include <istream>
+#include <string>
+#include <pthread.h>
+
+// Thinks about the next turn while the engine waits for the opponent. The
+// state of a turn and the orders sent are recorded like the trace does,
+// after the turn a background thread plays them one turn ahead, without
+// the enemy fleets yet to come, and hands the result to think together
+// with the owner given at construction. Whatever
+// think leaves in the caches is reused when the real state matches. The
+// main thread stops the pondering before it works on the next turn, so
+// the two never run at the same time. Think checks Aborted between its
+// steps and returns early once the real turn waits. The thread lives as
+// long as the ponder and sleeps between the turns, so its thread locals
+// are made once.
+class Ponder {
+public:
+	typedef void (*Think)(void* owner, PlanetVec& AP, FleetVec& AF);
+
+	Ponder(Think, void* owner);
+	~Ponder();
+
+	void BeginTurn(const PlanetVec& AP, const FleetVec& AF); // as parsed
+	void Order(const Fleet& order);
+	void Start(); // after the orders are sent
+	void Stop();  // aborts think and waits until it returns
+
+	bool Aborted() const { return __atomic_load_n(&abort, __ATOMIC_ACQUIRE); }
+
+private:
+	Think           think;
+	void*           owner;
+	PlanetVec       AP;
+	FleetVec        AF;
+	FleetVec        orders;
+	pthread_t       thread;
+	pthread_mutex_t lock;
+	pthread_cond_t  wake;    // a turn to think about or the end
+	pthread_cond_t  idle;    // think returned
+	bool            pending; // started and not taken by the thread yet
+	bool            busy;    // in think
+	bool            abort;   // think is to return
+	bool            quit;
+
+	static void* Main(void*);
+	void Run(); // one turn
+};
+
+// Reads the game states on its own thread and parses them into pw, the main
+// thread takes them from a single producer single consumer ring. A state is
+// only parsed once the main thread is done with the one before. Either side
+// sleeps on a condition variable while it waits for the other.
+class Reader {
+public:
+	Reader(PlanetWars& pw);
+	~Reader();
+
+	bool Next(); // blocks until the next state is parsed, false at the end
+	void Done(); // the main thread no longer uses pw
+
+	// started when the text of the state taken by Next was read
+	Timer& Arrived() { return arrived[(tail - 1) & (RING_SIZE - 1)]; }
+
+	// reads the text of the next state from in, false at the end of the input
+	static bool Read(std::istream& in, std::string& state);
+
+private:
+	enum { RING_SIZE = 4 };
+
+	PlanetWars&     pw;
+	bool            ring[RING_SIZE]; // a state or the end of the input
+	Timer           arrived[RING_SIZE];
+	unsigned int    head;            // next cell to fill, by the reader
+	unsigned int    tail;            // next cell to take, by the main thread
+	unsigned int    done;            // states the main thread is done with
+	pthread_mutex_t lock;            // of the counters
+	pthread_cond_t  changed;         // a counter moved on
+	pthread_t       thread;
+
+	static void* Main(void*);
+};
+
+#endif
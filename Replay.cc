@@ -0,0 +1,124 @@
+#include "Bot.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Reads game traces written with --trace. Lists every recorded turn of the
+// games, or with --play plays the recorded states again with the bot of
+// this build and counts the turns it orders the same as the recording, so
+// a change can be checked against the games of an older build.
+//
+//   replay [--play] <trace>...
+
+// the state in the format of the engine
+static std::string Text(const PlanetVec& AP, const FleetVec& AF) {
+	std::ostringstream s;
+	s.precision(17);
+	for (unsigned int i = 0, n = AP.size(); i < n; i++)
+	{
+		const Planet& p = AP[i];
+		s << "P " << p.X() << " " << p.Y() << " " << p.Owner() << " " << p.NumShips() << " " << p.GrowthRate() << "\n";
+	}
+	for (unsigned int i = 0, n = AF.size(); i < n; i++)
+	{
+		const Fleet& f = AF[i];
+		s << "F " << f.Owner() << " " << f.NumShips() << " " << f.SourcePlanet() << " " << f.DestinationPlanet() << " "
+		  << f.TotalTripLength() << " " << f.TurnsRemaining() << "\n";
+	}
+	return s.str();
+}
+
+// orders as sorted (source, destination, ships), the order of issue does not matter
+static std::vector<std::vector<int> > Key(const std::vector<Fleet>& orders) {
+	std::vector<std::vector<int> > key;
+	for (unsigned int i = 0, n = orders.size(); i < n; i++)
+	{
+		std::vector<int> o(3);
+		o[0] = orders[i].SourcePlanet();
+		o[1] = orders[i].DestinationPlanet();
+		o[2] = orders[i].NumShips();
+		key.push_back(o);
+	}
+	sort(key.begin(), key.end());
+	return key;
+}
+
+static void Count(const PlanetVec& AP, const FleetVec& AF, int owner, int& planets, int& ships) {
+	planets = ships = 0;
+	for (unsigned int i = 0, n = AP.size(); i < n; i++)
+	{
+		if (AP[i].Owner() != owner)
+			continue;
+		planets++;
+		ships += AP[i].NumShips();
+	}
+	for (unsigned int i = 0, n = AF.size(); i < n; i++)
+		if (AF[i].Owner() == owner)
+			ships += AF[i].NumShips();
+}
+
+int main(int argc, char *argv[]) {
+	bool play = false;
+	TraceReader reader;
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string(argv[i]) == "--play")
+		{
+			play = true;
+			continue;
+		}
+		if (!reader.Open(argv[i]))
+		{
+			fprintf(stderr, "%s: %s is no trace\n", argv[0], argv[i]);
+			return 1;
+		}
+		paths.push_back(argv[i]);
+	}
+	if (reader.Games() == 0)
+	{
+		fprintf(stderr, "usage: %s [--play] <trace>...\n", argv[0]);
+		return 1;
+	}
+
+	if (!play)
+		printf("game,turn,planets,fleets,my_planets,my_ships,enemy_planets,enemy_ships,orders\n");
+
+	for (int g = 0; g < reader.Games(); g++)
+	{
+		Bot bot; // the turns of a game follow each other, as they were played
+		int same = 0;
+		for (int i = 0, n = reader.Turns(g); i < n; i++)
+		{
+			Arena::Scope scope;
+			PlanetVec AP;
+			FleetVec  AF, recorded;
+			reader.Read(g, i, AP, AF, &recorded);
+			if (!play)
+			{
+				int mine, myShips, theirs, theirShips;
+				Count(AP, AF, 1, mine, myShips);
+				Count(AP, AF, 2, theirs, theirShips);
+				printf("%d,%d,%d,%d,%d,%d,%d,%d,%d\n", g, reader.Turn(g, i), int(AP.size()), int(AF.size()),
+					mine, myShips, theirs, theirShips, int(recorded.size()));
+				continue;
+			}
+
+			std::vector<Fleet> orders;
+			if (!bot.Play(Text(AP, AF), orders))
+				break;
+			const bool equal = Key(orders) == Key(std::vector<Fleet>(recorded.begin(), recorded.end()));
+			same += equal;
+			if (!equal)
+				printf("%s turn %d: %d orders, recorded %d\n", paths[g].c_str(), reader.Turn(g, i),
+					int(orders.size()), int(recorded.size()));
+		}
+		if (play)
+			printf("%s: %d of %d turns ordered the same\n", paths[g].c_str(), same, reader.Turns(g));
+	}
+	return 0;
+}
@@ -0,0 +1,207 @@
+#include "Router.h"
+
+#include <algorithm>
+#include <utility>
+
+#define MAX_DETOUR 1.0
+#define BETWEEN(v, a, b) ((v > a && v < b) || (v < a && v > b))
+
+Router::Router() {
+	pthread_mutex_init(&lock, NULL);
+}
+
+Router::~Router() {
+	Clear();
+	pthread_mutex_destroy(&lock);
+}
+
+__thread Router* Router::current = NULL;
+
+Router* Router::Instance() {
+	static Router router;
+	return (current != NULL)? current: &router;
+}
+
+// the next hops of the planets that changed hands and of the sources routing
+// through them are dropped
+void Router::Update(const PlanetVec& AP) {
+	bool same = locations.size() == AP.size();
+	for (unsigned int i = 0, n = AP.size(); i < n && same; i++)
+		same = locations[i] == AP[i].Loc();
+	if (!same)
+	{
+		Clear();
+		for (unsigned int i = 0, n = AP.size(); i < n; i++)
+			locations.push_back(AP[i].Loc());
+		rows.assign(AP.size(), NULL);
+		owners.assign(AP.size(), -1);
+		next.assign(AP.size(), std::vector<int>());
+		users.assign(AP.size(), std::vector<int>());
+	}
+
+	for (unsigned int i = 0, n = AP.size(); i < n; i++)
+	{
+		if (AP[i].Owner() == owners[i])
+			continue;
+
+		owners[i] = AP[i].Owner();
+		next[i].clear();
+		for (unsigned int j = 0, m = users[i].size(); j < m; j++)
+			next[users[i][j]].clear();
+	}
+}
+
+void Router::Clear() {
+	for (unsigned int i = 0, n = rows.size(); i < n; i++)
+		delete rows[i];
+	rows.clear();
+	locations.clear();
+	owners.clear();
+	next.clear();
+	users.clear();
+}
+
+int Router::GetHub(const PlanetVec& AP, int sid, int tid) {
+	ASSERT(AP.size() == rows.size());
+	const Row* row = Get(sid);
+	const int owner = AP[sid].Owner();
+	for (int i = row->offsets[tid], n = row->offsets[tid+1]; i < n; i++)
+		if (AP[row->hubs[i]].Owner() == owner)
+			return row->hubs[i];
+	return tid;
+}
+
+int Router::NextHop(int sid, int tid) {
+	std::vector<int>& hops = next[sid];
+	if (hops.empty())
+	{
+		const Row* row = Get(sid);
+		const int owner = owners[sid];
+		const int n = rows.size();
+		hops.resize(n);
+		for (int t = 0; t < n; t++)
+		{
+			hops[t] = t;
+			for (int i = row->offsets[t], m = row->offsets[t+1]; i < m; i++)
+			{
+				if (owners[row->hubs[i]] == owner)
+				{
+					hops[t] = row->hubs[i];
+					break;
+				}
+			}
+		}
+	}
+	return hops[tid];
+}
+
+// at most a hop per planet, should the detours ever lead in a circle
+void Router::Path(int sid, int tid, std::vector<int>& path) {
+	path.clear();
+	for (int hop = sid, n = rows.size(); hop != tid && int(path.size()) < n; )
+	{
+		hop = NextHop(hop, tid);
+		path.push_back(hop);
+	}
+	if (path.empty() || path.back() != tid)
+		path.push_back(tid);
+}
+
+void Router::Export(std::vector<int>& offsets, std::vector<int>& hubs) {
+	offsets.clear();
+	hubs.clear();
+	for (unsigned int sid = 0, n = rows.size(); sid < n; sid++)
+	{
+		const Row* row = Get(sid);
+		for (unsigned int tid = 0; tid <= n; tid++)
+			offsets.push_back(hubs.size() + row->offsets[tid]);
+		hubs.insert(hubs.end(), row->hubs.begin(), row->hubs.end());
+	}
+}
+
+void Router::Import(const int* offsets, const int* hubs) {
+	pthread_mutex_lock(&lock);
+	for (unsigned int sid = 0, n = rows.size(); sid < n; sid++)
+	{
+		if (rows[sid] != NULL)
+			continue;
+
+		Row* row = new Row();
+		const int* o = offsets + sid*(n+1);
+		for (unsigned int tid = 0; tid <= n; tid++)
+			row->offsets.push_back(o[tid] - o[0]);
+		row->hubs.assign(hubs + o[0], hubs + o[n]);
+		Publish(sid, row);
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+// the row of sid, built on first use
+Router::Row* Router::Get(int sid) {
+	Row* row = __atomic_load_n(&rows[sid], __ATOMIC_ACQUIRE);
+	if (row == NULL)
+	{
+		pthread_mutex_lock(&lock);
+		row = rows[sid];
+		if (row == NULL)
+		{
+			row = Build(sid);
+			Publish(sid, row);
+		}
+		pthread_mutex_unlock(&lock);
+	}
+	return row;
+}
+
+// the sources of a planet are kept for the next hops it changes, once per
+// candidate
+void Router::Publish(int sid, Row* row) {
+	std::vector<int> hubs(row->hubs);
+	sort(hubs.begin(), hubs.end());
+	hubs.erase(unique(hubs.begin(), hubs.end()), hubs.end());
+	for (unsigned int i = 0, n = hubs.size(); i < n; i++)
+		users[hubs[i]].push_back(sid);
+	__atomic_store_n(&rows[sid], row, __ATOMIC_RELEASE);
+}
+
+// A hub must project strictly between source and target, closer to the
+// source than the target and within the detour. The closest one wins, the
+// lowest id on a tie.
+Router::Row* Router::Build(int sid) const {
+	Row* row = new Row();
+	const vec3<double>& source = locations[sid];
+	std::vector<std::pair<double, int> > candidates;
+	for (unsigned int tid = 0, n = locations.size(); tid < n; tid++)
+	{
+		row->offsets.push_back(row->hubs.size());
+		const vec3<double>& target = locations[tid];
+		vec3<double> vecTarget = target - source;
+		if (int(tid) == sid || (vecTarget.x == 0.0 && vecTarget.z == 0.0))
+			continue;
+
+		const double s2t = vecTarget.len2D();
+		candidates.clear();
+		for (unsigned int hid = 0; hid < n; hid++)
+		{
+			if (int(hid) == sid || hid == tid)
+				continue;
+
+			vec3<double> vecHub = locations[hid] - source;
+			vec3<double> vecProjectHub = vecHub.project(vecTarget);
+			if (BETWEEN(vecProjectHub.x, 0.0, vecTarget.x) && BETWEEN(vecProjectHub.z, 0.0, vecTarget.z))
+			{
+				const double s2h = vecHub.len2D();
+				const double h2t = (locations[hid] - target).len2D();
+				const double pLength = vecProjectHub.len2D();
+				const double detour  = (s2h + h2t) - s2t;
+				if (pLength < s2t && detour <= MAX_DETOUR)
+					candidates.push_back(std::make_pair(pLength, hid));
+			}
+		}
+		sort(candidates.begin(), candidates.end());
+		for (unsigned int i = 0, m = candidates.size(); i < m; i++)
+			row->hubs.push_back(candidates[i].second);
+	}
+	row->offsets.push_back(row->hubs.size());
+	return row;
+}
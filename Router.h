@@ -0,0 +1,73 @@
+#ifndef ROUTER_
+#define ROUTER_
+
+#include "PlanetWars.h"
+
+#include <pthread.h>
+#include <vector>
+
+// Supply routes of one map. Ships from a source to a target are sent to a
+// hub instead when a planet of the source owner lies in between, with a
+// detour of at most MAX_DETOUR. The geometry is precomputed per source, on
+// first use: the hub candidates of every target ordered on their distance
+// from the source along the route. These tables live for the game.
+//
+// For the owners of the state given to Update the router also keeps the
+// next hop of every source and target, built per source on first use. A
+// planet changing hands only drops the next hops of itself and of the
+// sources it is a candidate of, the rest carry over to the next turn. A
+// path of hops to a target is then a lookup per hop.
+class Router {
+public:
+	Router();
+	~Router();
+
+	// the router of the game played on this thread, a shared one unless
+	// SetInstance gave the thread its own
+	static Router* Instance();
+	static void    SetInstance(Router* router) { current = router; }
+
+	// call before the queries of a turn, starts over on a different map
+	void Update(const PlanetVec& AP);
+
+	// the planet closest to sid on the way to tid owned by the owner of sid,
+	// or tid, safe to call from multiple threads
+	int GetHub(const PlanetVec& AP, int sid, int tid);
+
+	// GetHub for the owners of the state of the last Update, from the next
+	// hop tables. Not to be called while the state of Update is changed.
+	int NextHop(int sid, int tid);
+	// the hops from sid to tid, tid last
+	void Path(int sid, int tid, std::vector<int>& path);
+
+	// The tables of all sources, built where missing, for a MapCache. The
+	// candidates of sid for tid are hubs[offsets[sid*(n+1) + tid],
+	// offsets[sid*(n+1) + tid + 1]) on a map of n planets.
+	void Export(std::vector<int>& offsets, std::vector<int>& hubs);
+	// the tables of an Export on this map, call after Update
+	void Import(const int* offsets, const int* hubs);
+
+private:
+	// the hub candidates for target t are hubs[offsets[t], offsets[t+1])
+	struct Row {
+		std::vector<int> offsets;
+		std::vector<int> hubs;
+	};
+
+	std::vector<vec3<double> > locations;
+	std::vector<Row*>          rows;
+	pthread_mutex_t            lock;
+
+	std::vector<int>               owners; // of the state of the last Update
+	std::vector<std::vector<int> > next;   // per source the hub of every target, empty until used
+	std::vector<std::vector<int> > users;  // per planet the sources with a row it is a candidate in
+
+	static __thread Router* current;
+
+	Row* Get(int sid);
+	Row* Build(int sid) const;
+	void Publish(int sid, Row* row); // under the lock
+	void Clear();
+};
+
+#endif
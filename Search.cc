@@ -0,0 +1,406 @@
+#include "Search.h"
+#include "Simulator.h"
+#include "BatchSimulator.h"
+#include "Logger.h"
+#include "Map.h"
+#include "Router.h"
+#include "Strength.h"
+
+#include <algorithm>
+#include <limits>
+#include <queue>
+
+namespace search {
+	#include "Helper.inl"
+}
+
+#define MAX_DEPTH    16
+#define EVAL_HORIZON 25 // longer horizons overvalue expanding to neutrals
+#define TT_SIZE      (1<<16)
+#define INF          (std::numeric_limits<int>::max()/2)
+
+typedef std::priority_queue<search::NPV, std::vector<search::NPV, ArenaAllocator<search::NPV> > > NPVQueue;
+
+Search::Search(int tl, Timer& t, double dl):
+	turnsLeft(tl),
+	timer(t),
+	deadline(dl),
+	aborted(false),
+	depth(0),
+	nodes(0),
+	score(0)
+{
+}
+
+bool Search::Run(PlanetVec& AP, FleetVec& AF, FleetVec& candidate, FleetVec& best) {
+	Entry empty = {0, -1, 0, EXACT, -1};
+	table.assign(TT_SIZE, empty);
+
+	MoveList moves;
+	moves.push_back(candidate);
+	Generate(AP, AF, moves);
+
+	int bestMove = -1;
+	for (int d = 1; d <= MAX_DEPTH && d <= turnsLeft; d++)
+	{
+		int move = -1;
+		const int value = AlphaBeta(AP, AF, 0, d, -INF, INF, &moves, &move);
+		if (aborted)
+			break;
+
+		bestMove = move;
+		depth    = d;
+		score    = value;
+	}
+
+	if (bestMove == -1)
+		return false;
+
+	best = moves[bestMove];
+	return true;
+}
+
+int Search::AlphaBeta(PlanetVec& AP, FleetVec& AF, int ply, int d, int alpha, int beta, MoveList* root, int* bestMove) {
+	nodes++;
+	if (d == 0 || ply >= turnsLeft)
+		return Evaluate(AP, AF, ply);
+
+	if (TimeUp())
+	{
+		aborted = true;
+		return 0;
+	}
+
+	const unsigned int hash = Hash(AP, AF, turnsLeft - ply);
+	Entry* e = Probe(hash);
+	int ttMove = -1;
+	if (e->hash == hash)
+	{
+		ttMove = e->move;
+		if (root == NULL && e->depth >= d)
+		{
+			if (e->bound == EXACT)
+				return e->value;
+			if (e->bound == LOWER && e->value >= beta)
+				return e->value;
+			if (e->bound == UPPER && e->value <= alpha)
+				return e->value;
+		}
+	}
+
+	Arena::Scope scope;
+	MoveList  local;
+	MoveList& M = (root == NULL)? local: *root;
+	if (root == NULL)
+		Generate(AP, AF, local);
+
+	PlanetVec FAP; FleetVec FAF;
+	Flip(AP, AF, FAP, FAF);
+	MoveList E;
+	Generate(FAP, FAF, E);
+
+	// move ordering, the best move of a previous (shallower) search goes first
+	IntVec order;
+	if (ttMove >= 0 && ttMove < int(M.size()))
+		order.push_back(ttMove);
+	for (int i = 0, n = M.size(); i < n; i++)
+		if (i != ttMove)
+			order.push_back(i);
+
+	const int alpha0 = alpha;
+	int best    = -INF;
+	int bestIdx = order[0];
+	// when the replies lead to leaves they are all scored in one batch
+	const bool leaves = d == 1 || ply+1 >= turnsLeft;
+	PlanetVec CAP; FleetVec CAF;
+	for (unsigned int i = 0, n = order.size(); i < n && best < beta; i++)
+	{
+		IntVec scores(leaves? E.size(): 0);
+		if (leaves)
+			EvaluateReplies(AP, AF, M[order[i]], E, ply+1, scores);
+
+		int worst = INF;
+		for (unsigned int j = 0, m = E.size(); j < m; j++)
+		{
+			const int lo = std::max<int>(alpha, best);
+			const int hi = std::min<int>(beta, worst);
+			int v;
+			if (leaves)
+			{
+				nodes++;
+				v = scores[j];
+			}
+			else
+			{
+				CAP = AP;
+				CAF = AF;
+				Apply(CAP, CAF, M[order[i]], 1);
+				Apply(CAP, CAF, E[j], 2);
+				{
+					Arena::Scope advance;
+					Simulator sim;
+					sim.Start(1, CAP, CAF, true, false);
+				}
+
+				v = AlphaBeta(CAP, CAF, ply+1, d-1, lo, hi, NULL, NULL);
+				if (aborted)
+					return 0;
+			}
+
+			worst = std::min<int>(worst, v);
+			if (worst <= lo)
+				break;
+		}
+
+		if (worst > best)
+		{
+			best    = worst;
+			bestIdx = order[i];
+		}
+	}
+
+	e->hash  = hash;
+	e->depth = d;
+	e->value = best;
+	e->move  = bestIdx;
+	if (best <= alpha0)
+		e->bound = UPPER;
+	else
+	if (best >= beta)
+		e->bound = LOWER;
+	else
+		e->bound = EXACT;
+
+	if (bestMove != NULL)
+		*bestMove = bestIdx;
+
+	return best;
+}
+
+int Search::Evaluate(PlanetVec& AP, FleetVec& AF, int ply) {
+	Arena::Scope scope;
+	Simulator sim;
+	return sim.StartScore(std::min<int>(turnsLeft - ply, EVAL_HORIZON), AP, AF);
+}
+
+// Evaluate() of the states after our move, each of the replies and the turn
+// of advance, the advance is simulated as part of the horizon
+void Search::EvaluateReplies(PlanetVec& AP, FleetVec& AF, const FleetVec& move, MoveList& E, int ply, IntVec& scores) {
+	Arena::Scope scope;
+	PlanetVec CAP(AP);
+	FleetVec  CAF(AF);
+	Apply(CAP, CAF, move, 1);
+	BatchSimulator batch(CAP, CAF);
+	for (unsigned int j = 0, m = E.size(); j < m; j++)
+		batch.Launch(batch.AddScenario(), E[j], 2);
+
+	batch.Run(1 + std::min<int>(turnsLeft - ply, EVAL_HORIZON));
+	for (unsigned int j = 0, m = E.size(); j < m; j++)
+		scores[j] = batch.GetScore(j);
+}
+
+bool Search::TimeUp() {
+	timer.Tock();
+	return timer.Time() > deadline;
+}
+
+unsigned int Search::Hash(const PlanetVec& AP, const FleetVec& AF, int horizon) {
+	#define MIX(h, v) (((h) ^ (unsigned int)(v)) * 16777619u)
+	unsigned int h = MIX(2166136261u, horizon);
+	for (unsigned int i = 0, n = AP.size(); i < n; i++)
+	{
+		h = MIX(h, AP[i].Owner());
+		h = MIX(h, AP[i].NumShips());
+	}
+
+	// fleets are combined order independent, the fleet order depends on the
+	// path that led to a state
+	unsigned int fh = 0;
+	for (unsigned int i = 0, n = AF.size(); i < n; i++)
+	{
+		const Fleet& f = AF[i];
+		unsigned int k = 2166136261u;
+		k = MIX(k, f.Owner());
+		k = MIX(k, f.NumShips());
+		k = MIX(k, f.DestinationPlanet());
+		k = MIX(k, f.TurnsRemaining());
+		fh += k;
+	}
+	return MIX(h, fh);
+	#undef MIX
+}
+
+Search::Entry* Search::Probe(unsigned int hash) {
+	return &table[hash & (TT_SIZE - 1)];
+}
+
+void Search::Flip(const PlanetVec& AP, const FleetVec& AF, PlanetVec& FAP, FleetVec& FAF) {
+	FAP = AP;
+	FAF = AF;
+	for (unsigned int i = 0, n = FAP.size(); i < n; i++)
+		if (FAP[i].Owner() > 0)
+			FAP[i].Owner(3 - FAP[i].Owner());
+
+	for (unsigned int i = 0, n = FAF.size(); i < n; i++)
+		FAF[i].Owner(3 - FAF[i].Owner());
+}
+
+void Search::Apply(PlanetVec& AP, FleetVec& AF, const FleetVec& orders, int owner) {
+	for (unsigned int i = 0, n = orders.size(); i < n; i++)
+	{
+		const Fleet& o = orders[i];
+		AP[o.SourcePlanet()].RemoveShips(o.NumShips());
+		AF.push_back(Fleet(owner, o.NumShips(), o.SourcePlanet(),
+			o.DestinationPlanet(), o.TotalTripLength(), o.TurnsRemaining()));
+	}
+}
+
+static void AddOrder(FleetVec& orders, IntVec& left, int sid, int tid, int numShips) {
+	const int dist = search::gAP->at(sid).Distance(search::gAP->at(tid));
+	orders.push_back(Fleet(1, numShips, sid, tid, dist, dist));
+	left[sid] -= numShips;
+}
+
+// every frontline planet attacks the weakest enemy planet, if it can take
+// it on its own
+static void AttackOrders(Map& map, IntVec& EPIDX, IntVec& EFIDX, IntVec& left, FleetVec& orders) {
+	const PlanetVec& AP = *search::gAP;
+	IntVec& FLPIDX = map.GetFrontLine();
+	if (FLPIDX.empty())
+		return;
+
+	const Strength strength(AP, *search::gAF, EPIDX, EPIDX, EFIDX);
+	for (unsigned int i = 0, n = FLPIDX.size(); i < n; i++)
+	{
+		const Planet& source = AP[FLPIDX[i]];
+		const int sid = source.PlanetID();
+		const int tid = strength.Weakest(sid, NULL);
+		if (tid == -1)
+			continue;
+
+		const Planet& target = AP[tid];
+		const int dist = target.Distance(source);
+		const int required = target.NumShips() + dist*target.GrowthRate() +
+			search::GetIncommingFleets(tid, EFIDX, dist) + 1;
+		if (left[sid] >= required)
+			AddOrder(orders, left, sid, tid, left[sid]);
+	}
+}
+
+// capture the most valuable neutrals that we reach before the enemy does
+static void ExpandOrders(Map& map, IntVec& MPIDX, IntVec& NPIDX, IntVec& EPIDX, IntVec& left, FleetVec& orders) {
+	const PlanetVec& AP = *search::gAP;
+	NPVQueue PQ;
+	for (unsigned int i = 0, n = NPIDX.size(); i < n; i++)
+	{
+		const Planet& target = AP[NPIDX[i]];
+		const int sid = map.GetClosestPlanetIdx(target.Loc(), MPIDX);
+		if (sid == -1)
+			continue;
+
+		const int dist = target.Distance(AP[sid]);
+		PQ.push(search::NPV(target.PlanetID(), search::GetValue(target, dist)));
+	}
+
+	while (!PQ.empty())
+	{
+		const Planet& target = AP[PQ.top().id];
+		PQ.pop();
+		const int eid = map.GetClosestPlanetIdx(target.Loc(), EPIDX);
+		const int edist = (eid == -1)? std::numeric_limits<int>::max(): target.Distance(AP[eid]);
+		const int numShips = target.NumShips() + 1;
+		int sid = -1;
+		int mdist = std::numeric_limits<int>::max();
+		for (unsigned int j = 0, m = MPIDX.size(); j < m; j++)
+		{
+			const int pid = MPIDX[j];
+			const int dist = target.Distance(AP[pid]);
+			if (left[pid] >= numShips && dist < mdist)
+			{
+				mdist = dist;
+				sid = pid;
+			}
+		}
+
+		if (sid != -1 && mdist < edist)
+			AddOrder(orders, left, sid, target.PlanetID(), numShips);
+	}
+}
+
+// planets behind the frontline route their ships towards it
+static void FeedOrders(Map& map, IntVec& MPIDX, IntVec& left, FleetVec& orders) {
+	const PlanetVec& AP = *search::gAP;
+	IntVec& FLPIDX = map.GetFrontLine();
+	for (unsigned int i = 0, n = MPIDX.size(); i < n; i++)
+	{
+		const Planet& source = AP[MPIDX[i]];
+		const int sid = source.PlanetID();
+		if (left[sid] <= 0 || map.IsFrontLine(sid))
+			continue;
+
+		const int tid = map.GetClosestPlanetIdx(source.Loc(), FLPIDX);
+		if (tid == -1)
+			continue;
+
+		AddOrder(orders, left, sid, Router::Instance()->GetHub(AP, sid, tid), left[sid]);
+	}
+}
+
+void Search::Generate(PlanetVec& AP, FleetVec& AF, MoveList& moves) {
+	search::gAP = &AP;
+	search::gAF = &AF;
+	moves.push_back(FleetVec());
+
+	IntVec MPIDX, EPIDX, NPIDX, EFIDX;
+	for (unsigned int i = 0, n = AP.size(); i < n; i++)
+	{
+		const Planet& p = AP[i];
+		switch (p.Owner())
+		{
+			case 0:  if (p.GrowthRate() > 0) NPIDX.push_back(p.PlanetID()); break;
+			case 1:  MPIDX.push_back(p.PlanetID()); break;
+			default: EPIDX.push_back(p.PlanetID()); break;
+		}
+	}
+
+	if (MPIDX.empty())
+		return;
+
+	for (unsigned int i = 0, n = AF.size(); i < n; i++)
+		if (AF[i].Owner() != 1)
+			EFIDX.push_back(i);
+
+	// ships that are not needed against incomming enemy fleets
+	IntVec spare(AP.size(), 0);
+	for (unsigned int i = 0, n = MPIDX.size(); i < n; i++)
+	{
+		const int pid = MPIDX[i];
+		spare[pid] = std::max<int>(0, AP[pid].NumShips() - search::GetIncommingFleets(pid, EFIDX));
+	}
+
+	Map map(AP);
+	IntVec left;
+	FleetVec orders;
+
+	left = spare;
+	AttackOrders(map, EPIDX, EFIDX, left, orders);
+	if (!orders.empty())
+		moves.push_back(orders);
+
+	left = spare; orders.clear();
+	ExpandOrders(map, MPIDX, NPIDX, EPIDX, left, orders);
+	if (!orders.empty())
+		moves.push_back(orders);
+
+	left = spare; orders.clear();
+	FeedOrders(map, MPIDX, left, orders);
+	if (!orders.empty())
+		moves.push_back(orders);
+
+	left = spare; orders.clear();
+	ExpandOrders(map, MPIDX, NPIDX, EPIDX, left, orders);
+	AttackOrders(map, EPIDX, EFIDX, left, orders);
+	FeedOrders(map, MPIDX, left, orders);
+	if (!orders.empty())
+		moves.push_back(orders);
+}
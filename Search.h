@@ -0,0 +1,76 @@
+#ifndef SEARCH_
+#define SEARCH_
+
+#include "PlanetWars.h"
+#include "Timer.h"
+
+#include <vector>
+
+// Iterative deepening alpha-beta search over macro moves. Each ply both
+// sides pick one order set, generated from the same heuristics as the
+// DoTurn phases, after which the state is advanced one turn. The enemy
+// replies knowing our move, which makes the search pessimistic. Leaves are
+// scored with the Simulator over the next turns.
+class Search {
+public:
+	typedef std::vector<FleetVec, ArenaAllocator<FleetVec> > MoveList;
+
+	Search(int turnsLeft, Timer& timer, double deadline);
+
+	// Searches the state for player 1 until the deadline passes. The
+	// candidate is tried first at the root. Returns false when not even
+	// depth 1 was completed, in which case best is left untouched.
+	bool Run(PlanetVec& AP, FleetVec& AF, FleetVec& candidate, FleetVec& best);
+
+	int Depth() const { return depth; } // deepest completed iteration
+	int Nodes() const { return nodes; }
+	int Score() const { return score; } // score of the best move
+
+	// Order sets for player 1 modelled after the ATTACK, EXPAND and FEED
+	// phases, the empty order set (pass) is always the first
+	static void Generate(PlanetVec& AP, FleetVec& AF, MoveList& moves);
+
+	// Swap player 1 and 2 so the generator can be used for the enemy
+	static void Flip(const PlanetVec& AP, const FleetVec& AF, PlanetVec& FAP, FleetVec& FAF);
+
+	// Launch the orders as fleets of owner
+	static void Apply(PlanetVec& AP, FleetVec& AF, const FleetVec& orders, int owner);
+
+	// key of a state with the given horizon, independent of the fleet order
+	static unsigned int Hash(const PlanetVec&, const FleetVec&, int horizon);
+
+private:
+	enum Bound {
+		EXACT,
+		LOWER,
+		UPPER
+	};
+
+	struct Entry {
+		unsigned int hash;
+		int depth;
+		int value;
+		int bound;
+		int move; // index of the best move for player 1
+	};
+
+	typedef std::vector<Entry, ArenaAllocator<Entry> > Table;
+
+	int    turnsLeft;
+	Timer& timer;
+	double deadline;
+	bool   aborted;
+	int    depth;
+	int    nodes;
+	int    score;
+	Table  table; // transposition table, the key includes the horizon
+
+	int  AlphaBeta(PlanetVec&, FleetVec&, int ply, int depth, int alpha, int beta, MoveList* root, int* bestMove);
+	int  Evaluate(PlanetVec&, FleetVec&, int ply);
+	void EvaluateReplies(PlanetVec&, FleetVec&, const FleetVec& move, MoveList& E, int ply, IntVec& scores);
+	bool TimeUp();
+
+	Entry* Probe(unsigned int);
+};
+
+#endif
@@ -0,0 +1,120 @@
+#include "SimBase.h"
+#include "Logger.h"
+
+#include <algorithm>
+
+__thread const SimBase*  SimBase::current = NULL;
+__thread const FleetVec* SimBase::fleets  = NULL;
+
+// two stable counting sorts, first on the turns and then on the
+// destination, as Simulator::Bucket does for a single simulation. Both
+// orders are kept.
+SimBase::SimBase(const FleetVec& AF, int numPlanets):
+	numFleets(AF.size()),
+	begin(numPlanets + 1, 0),
+	order(AF.size()),
+	turns(AF.size()),
+	minTurns(0),
+	byTurns(AF.size()),
+	position(AF.size())
+{
+	int lo = 0, hi = 0;
+	for (unsigned int i = 0; i < numFleets; i++)
+	{
+		lo = (i == 0)? AF[i].TurnsRemaining(): std::min(lo, AF[i].TurnsRemaining());
+		hi = (i == 0)? AF[i].TurnsRemaining(): std::max(hi, AF[i].TurnsRemaining());
+	}
+
+	minTurns = lo;
+	arrive.assign(hi - lo + 2, 0);
+	for (unsigned int i = 0; i < numFleets; i++)
+	{
+		arrive[AF[i].TurnsRemaining() - lo + 1]++;
+		begin[AF[i].DestinationPlanet() + 1]++;
+	}
+	for (unsigned int t = 1, n = arrive.size(); t < n; t++)
+		arrive[t] += arrive[t-1];
+	for (int d = 1; d <= numPlanets; d++)
+	{
+		if (begin[d] > 0)
+			destinations.push_back(d - 1);
+		begin[d] += begin[d-1];
+	}
+
+	IntVec next(arrive.begin(), arrive.end() - 1);
+	for (unsigned int i = 0; i < numFleets; i++)
+		byTurns[next[AF[i].TurnsRemaining() - lo]++] = i;
+
+	next.assign(begin.begin(), begin.end() - 1);
+	for (unsigned int i = 0; i < numFleets; i++)
+	{
+		const Fleet& f = AF[byTurns[i]];
+		const int j = next[f.DestinationPlanet()]++;
+		order[j] = byTurns[i];
+		turns[j] = f.TurnsRemaining();
+		position[byTurns[i]] = j;
+	}
+}
+
+const SimBase* SimBase::Instance(const FleetVec& AF) {
+	if (current == NULL || fleets != &AF || AF.size() < current->numFleets)
+		return NULL;
+	ASSERT_MSG(current->Holds(AF), "The fleets changed under their base");
+	return current;
+}
+
+SimBase::Scope::Scope(const SimBase* base, const FleetVec& AF):
+	previous(current),
+	previousFleets(fleets)
+{
+	current = base;
+	fleets  = &AF;
+}
+
+SimBase::Scope::~Scope() {
+	current = previous;
+	fleets  = previousFleets;
+}
+
+void SimBase::Landing(int pid, int lo, int hi, IntVec& result) const {
+	const IntVec::const_iterator first = turns.begin() + begin[pid];
+	const IntVec::const_iterator last  = turns.begin() + begin[pid+1];
+	const int from = std::lower_bound(first, last, lo) - turns.begin();
+	const int to   = std::upper_bound(first, last, hi) - turns.begin();
+	result.insert(result.end(), order.begin() + from, order.begin() + to);
+}
+
+void SimBase::Landing(int lo, int hi, IntVec& result) const {
+	if (numFleets == 0)
+		return;
+	const int from = arrive[std::max(0, std::min<int>(lo - minTurns, arrive.size() - 1))];
+	const int to   = arrive[std::max(0, std::min<int>(hi - minTurns + 1, arrive.size() - 1))];
+	if (to - from >= int(destinations.size()))
+	{
+		for (unsigned int i = 0, n = destinations.size(); i < n; i++)
+			Landing(destinations[i], lo, hi, result);
+		return;
+	}
+
+	// sorted on their place in order, which is on destination and turns
+	IntVec landing;
+	for (int i = from; i < to; i++)
+		landing.push_back(position[byTurns[i]]);
+	std::sort(landing.begin(), landing.end());
+	for (unsigned int i = 0, n = landing.size(); i < n; i++)
+		result.push_back(order[landing[i]]);
+}
+
+// the fleets indexed are where and as they were, as far as the index goes
+bool SimBase::Holds(const FleetVec& AF) const {
+	for (unsigned int pid = 0; pid + 1 < begin.size(); pid++)
+	{
+		for (int j = begin[pid]; j < begin[pid+1]; j++)
+		{
+			const Fleet& f = AF[order[j]];
+			if (f.DestinationPlanet() != int(pid) || f.TurnsRemaining() != turns[j])
+				return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,63 @@
+#ifndef SIMBASE_
+#define SIMBASE_
+
+#include "PlanetWars.h"
+
+// The state of a turn as the simulations of the turn share it: its fleets
+// counting sorted once on destination and turns remaining. A simulation
+// then finds the fleets landing on a planet within its horizon with a
+// binary search instead of going over all fleets. The checks of a turn add
+// hypothetical fleets to the end of the fleets and take them off again, the
+// fleets past the ones indexed are merged in one by one. Valid while the
+// fleets indexed stay the first ones of the fleets, as they are.
+//
+// A base is bound to the fleets it holds for on a thread, the private copy
+// of the fleets of an evaluation included, and the Simulator uses it for
+// those fleets only.
+class SimBase {
+public:
+	SimBase(const FleetVec& AF, int numPlanets);
+
+	// the base bound to AF on this thread, NULL when there is none
+	static const SimBase* Instance(const FleetVec& AF);
+
+	// binds a base to the fleets AF on this thread for its lifetime
+	class Scope {
+	public:
+		Scope(const SimBase* base, const FleetVec& AF);
+		~Scope();
+	private:
+		const SimBase*  previous;
+		const FleetVec* previousFleets;
+	};
+
+	unsigned int NumFleets() const { return numFleets; }
+
+	// appends the fleets indexed heading for pid that land within lo..hi
+	// turns to result, ordered on turns remaining
+	void Landing(int pid, int lo, int hi, IntVec& result) const;
+
+	// appends the fleets indexed that land within lo..hi turns to result,
+	// ordered on destination and turns remaining. Goes over the planets
+	// fleets head for or over the fleets that land in time, whichever are
+	// fewer.
+	void Landing(int lo, int hi, IntVec& result) const;
+
+private:
+	unsigned int numFleets;
+	IntVec begin; // per planet [begin[pid], begin[pid+1]) in order and turns
+	IntVec order; // the fleets on destination and turns remaining
+	IntVec turns; // turns remaining of the fleets in order
+	IntVec destinations; // the planets fleets head for, ascending
+	int    minTurns; // of the fleets
+	IntVec byTurns; // the fleets on turns remaining
+	IntVec arrive;  // per turns remaining t, [arrive[t-minTurns], arrive[t-minTurns+1]) in byTurns
+	IntVec position; // per fleet its index in order
+
+	bool Holds(const FleetVec& AF) const;
+
+	static __thread const SimBase*  current;
+	static __thread const FleetVec* fleets; // current is bound to
+};
+
+#endif
@@ -0,0 +1,115 @@
+#include "SimCache.h"
+#include "Counters.h"
+#include "ThreadKey.h"
+
+#include <cstdlib>
+
+#define OUTCOME_SLOTS (1<<12) // about 450 KB per thread
+#define SCORE_SLOTS   (1<<12)
+
+__thread SimCache* SimCache::instance = NULL;
+
+// the finalizer of splitmix64, every input bit changes half the output bits
+static inline unsigned long long Mix(unsigned long long x) {
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+static inline unsigned long long Pack(int a, int b, int c, int d) {
+	return ((unsigned long long)(unsigned short)a << 48) | ((unsigned long long)(unsigned short)b << 32) |
+		((unsigned long long)(unsigned short)c << 16) | (unsigned long long)(unsigned short)d;
+}
+
+SimCache::SimCache():
+	epoch(0)
+{
+	// zero keys are empty slots
+	outcomes = static_cast<Outcome*>(calloc(OUTCOME_SLOTS, sizeof(Outcome)));
+	scores   = static_cast<Score*>(calloc(SCORE_SLOTS, sizeof(Score)));
+}
+
+SimCache::~SimCache() {
+	free(outcomes);
+	free(scores);
+}
+
+SimCache* SimCache::Instance() {
+	if (instance == NULL)
+	{
+		static const pthread_key_t key = NewKey(Destroy); // frees the cache of a thread that exits
+		instance = new SimCache();
+		pthread_setspecific(key, instance);
+	}
+	return instance;
+}
+
+void SimCache::Destroy(void* cache) {
+	delete static_cast<SimCache*>(cache);
+	instance = NULL;
+}
+
+unsigned long long SimCache::PlanetKey(const Planet& p) {
+	return Mix(Pack(1, p.PlanetID(), p.GrowthRate(), p.Owner()) ^ Mix((unsigned int)p.NumShips()));
+}
+
+unsigned long long SimCache::FleetKey(const Fleet& f) {
+	return Mix(Pack(2, f.Owner(), f.DestinationPlanet(), f.TurnsRemaining()) ^ Mix((unsigned int)f.NumShips()));
+}
+
+unsigned long long SimCache::StateKey(const PlanetVec& AP, const FleetVec& AF) {
+	unsigned long long key = 0;
+	for (unsigned int i = 0, n = AP.size(); i < n; i++)
+		key += PlanetKey(AP[i]);
+	for (unsigned int i = 0, n = AF.size(); i < n; i++)
+		key += FleetKey(AF[i]);
+	return key;
+}
+
+unsigned long long SimCache::Horizon(unsigned long long key, int horizon, Kind kind) {
+	const unsigned long long k = Mix(key ^ Pack(kind, horizon, 0, 0));
+	return (k == 0)? 1: k;
+}
+
+const SimCache::Outcome* SimCache::FindOutcome(unsigned long long key) {
+	const Outcome& o = outcomes[key & (OUTCOME_SLOTS - 1)];
+	const bool hit = o.key == key && o.epoch == epoch;
+	Counters::Add(hit? Counters::SIM_CACHE_HITS: Counters::SIM_CACHE_MISSES);
+	return hit? &o: NULL;
+}
+
+const SimCache::Score* SimCache::FindScore(unsigned long long key) {
+	const Score& s = scores[key & (SCORE_SLOTS - 1)];
+	const bool hit = s.key == key && s.epoch == epoch;
+	Counters::Add(hit? Counters::SIM_CACHE_HITS: Counters::SIM_CACHE_MISSES);
+	return hit? &s: NULL;
+}
+
+void SimCache::StoreOutcome(unsigned long long key, const Planet& p, const Simulator::History& history) {
+	if (history.size() > MAX_HISTORY)
+		return;
+
+	Outcome& o = outcomes[key & (OUTCOME_SLOTS - 1)];
+	if (o.key == 0)
+		Counters::Add(Counters::SIM_CACHE_ENTRIES);
+	o.key        = key;
+	o.epoch      = epoch;
+	o.owner      = p.Owner();
+	o.ships      = p.NumShips();
+	o.numHistory = history.size();
+	for (int i = 0; i < o.numHistory; i++)
+		o.history[i] = history[i];
+}
+
+void SimCache::StoreScore(unsigned long long key, int myNumShips, int enemyNumShips) {
+	Score& s = scores[key & (SCORE_SLOTS - 1)];
+	if (s.key == 0)
+		Counters::Add(Counters::SIM_CACHE_ENTRIES);
+	s.key           = key;
+	s.epoch         = epoch;
+	s.myNumShips    = myNumShips;
+	s.enemyNumShips = enemyNumShips;
+}
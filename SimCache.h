@@ -0,0 +1,71 @@
+#ifndef SIMCACHE_
+#define SIMCACHE_
+
+#include "PlanetWars.h"
+#include "Simulator.h"
+
+// Memo of Simulator results. The outcome of a planet only follows from the
+// planet and the fleets landing on it within the horizon, so StartPlanets
+// looks it up under a key of just those, whatever happens elsewhere on the
+// map and in whichever turn. StartScore looks up the score under a key of
+// the whole state.
+//
+// Keys are Zobrist style: the sum of a 64 bit key per planet (id, growth,
+// owner, ships) and per fleet (owner, ships, destination, turns remaining),
+// so they do not depend on the fleet order and follow a change of one part
+// by subtracting its old key and adding the new one. Every thread has its
+// own direct mapped tables of fixed size entries, a new result replaces
+// the one in its slot. They are freed when the thread exits.
+class SimCache {
+public:
+	enum { MAX_HISTORY = 4 }; // longer histories are not kept
+	enum Kind { OUTCOME, SCORE };
+
+	struct Outcome {
+		unsigned long long key;
+		unsigned int epoch; // of the cache when stored
+		int owner;
+		int ships;
+		int numHistory;
+		Simulator::PlanetOwner history[MAX_HISTORY];
+	};
+
+	struct Score {
+		unsigned long long key;
+		unsigned int epoch;
+		int myNumShips;
+		int enemyNumShips;
+	};
+
+	static SimCache* Instance(); // of this thread
+
+	static unsigned long long PlanetKey(const Planet& p);
+	static unsigned long long FleetKey(const Fleet& f);
+	static unsigned long long StateKey(const PlanetVec& AP, const FleetVec& AF);
+	// the key of the results of a kind over horizon turns
+	static unsigned long long Horizon(unsigned long long key, int horizon, Kind kind);
+
+	// the outcome or score stored under key, or NULL
+	const Outcome* FindOutcome(unsigned long long key);
+	const Score*   FindScore(unsigned long long key);
+
+	void StoreOutcome(unsigned long long key, const Planet& p, const Simulator::History& history);
+	void StoreScore(unsigned long long key, int myNumShips, int enemyNumShips);
+
+	// drops all results in constant time, for measuring the misses
+	void Clear() { epoch++; }
+
+private:
+	SimCache();
+	~SimCache();
+
+	Outcome*     outcomes;
+	Score*       scores;
+	unsigned int epoch; // results of an older one are dropped
+
+	static __thread SimCache* instance;
+
+	static void Destroy(void* cache);
+};
+
+#endif
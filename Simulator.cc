@@ -1,7 +1,10 @@
 #include "Simulator.h"
 
+#include "Counters.h"
+#include "SimCache.h"
+#include "SimBase.h"
+
 #include <algorithm>
-#include <list>
 
 
 namespace sim {
@@ -9,99 +12,244 @@ namespace sim {
 }
 
 void Simulator::Start(int totalTurns, 
-					std::vector<Planet>& refAP, 
-					std::vector<Fleet>& refAF,
+					PlanetVec& refAP, 
+					FleetVec& refAF,
 					bool removeFleets, bool makeCopy) {
+	Counters::Add(Counters::SIMULATIONS);
+	Counters::Add(Counters::SIMULATED_FLEETS, refAF.size());
 	myNumShips = enemyNumShips = 0;
-	std::vector<int> skipPlanets;
-	std::list<unsigned int> remove;
+	targets.clear();
+	ownershipHistory.clear();
+	horizon = totalTurns;
+	AF = &refAF;
 
+	// the fleets are only read, the fleet turns after the simulation follow
+	// from the turns before it. A copy is an overlay on the planets passed:
+	// only the planets that fleets land on are copied here, the others are
+	// copied when asked for by GetPlanet() and the score is counted when
+	// asked for.
 	if (makeCopy)
 	{
-		copyAP.resize(refAP.size());
-		copyAF.resize(refAF.size());
-		copyAP = refAP;
-		copyAF = refAF;
+		base = &refAP;
 		AP = &copyAP;
-		AF = &copyAF;
+		copyAP.clear();
+		copyAP.reserve(refAP.size()); // GetPlanet() references stay valid
+		slots.clear();
 	}
 	else
 	{
+		// moving the fleets on changes them under a base
+		ASSERT(SimBase::Instance(refAF) == NULL);
+		base = NULL;
 		AP = &refAP;
-		AF = &refAF;
+		for (unsigned int i = 0, n = refAP.size(); i < n; i++)
+		{
+			Planet& p = refAP[i];
+			ownershipHistory[p.PlanetID()].push_back(PlanetOwner(p.Owner(), 0, 0, p.NumShips()));
+		}
 	}
 
-	ownershipHistory.clear();
-	for (unsigned int i = 0, n = refAP.size(); i < n; i++)
+	// only the fleets that land within the horizon change a planet, the
+	// others just fly on while their destination grows. The fleets come
+	// on planet, the planets in place in between them only grow.
+	IntVec order;
+	Bucket(1, totalTurns, refAP.size(), NULL, order);
+	int grown = 0;
+	for (unsigned int i = 0, n = order.size(); i < n;)
+	{
+		const int pid = AF->at(order[i]).DestinationPlanet();
+		unsigned int end = i + 1;
+		while (end < n && AF->at(order[end]).DestinationPlanet() == pid)
+		{
+			end++;
+		}
+		if (makeCopy)
+		{
+			Planet& p = Materialize(pid);
+			ownershipHistory[pid].push_back(PlanetOwner(p.Owner(), 0, 0, p.NumShips()));
+			Land(p, order, i, end, totalTurns, true);
+		}
+		else
+		{
+			Grow(grown, pid, totalTurns);
+			Land(AP->at(pid), order, i, end, totalTurns, true);
+			Count(AP->at(pid));
+			grown = pid + 1;
+		}
+		i = end;
+	}
+	if (makeCopy)
 	{
-		Planet& p = refAP[i];
-		ownershipHistory[p.PlanetID()] = std::vector<PlanetOwner>();
-		ownershipHistory[p.PlanetID()].push_back(PlanetOwner(p.Owner(), 0, 0, p.NumShips()));
+		counted = false;
+		return;
 	}
 
-	sort(AF->begin(), AF->end(), sim::SortOnPlanetAndTurnsLeft);
+	Grow(grown, refAP.size(), totalTurns);
+	CountFleets(totalTurns, removeFleets);
+	counted = true;
+	Advance(totalTurns, removeFleets);
+}
 
-	// Begin simulation
-	int turnsTaken = 0;
-	for (unsigned int i = 0, n = AF->size(); i < n; i++)
-	{
-		Fleet& f = AF->at(i);
-		unsigned int index = i;
+void Simulator::StartPlanet(int totalTurns, PlanetVec& refAP, FleetVec& refAF, int planet) {
+	IntVec planets(1, planet);
+	StartPlanets(totalTurns, refAP, refAF, planets);
+}
 
-		if (f.TurnsRemaining() <= 0 && removeFleets)
+void Simulator::StartPlanets(int totalTurns, PlanetVec& refAP, FleetVec& refAF, const IntVec& planets) {
+	myNumShips = enemyNumShips = 0;
+	counted = true;
+	targets = planets;
+	base = NULL;
+	AP = &copyAP;
+	AF = &refAF;
+
+	copyAP.clear();
+	ownershipHistory.clear();
+
+	// the outcome of a planet only depends on the fleets landing on it
+	// within the horizon
+	IntVec order;
+	Bucket(1, totalTurns, refAP.size(), &planets, order);
+	IntVec first(planets.size(), 0), last(planets.size(), 0); // of its fleets in order
+	KeyVec keys(planets.size());
+	for (unsigned int i = 0, n = planets.size(); i < n; i++)
+	{
+		const Planet& p = refAP[planets[i]];
+		copyAP.push_back(p);
+		keys[i] = SimCache::PlanetKey(p);
+	}
+	for (unsigned int i = 0, n = order.size(); i < n;)
+	{
+		const int pid = AF->at(order[i]).DestinationPlanet();
+		unsigned int end = i;
+		unsigned long long key = 0;
+		while (end < n && AF->at(order[end]).DestinationPlanet() == pid)
 		{
-			ASSERT(f.TurnsRemaining() > 0);
+			key += SimCache::FleetKey(AF->at(order[end]));
+			end++;
 		}
-		else
-		if (f.TurnsRemaining() <= 0)
+		for (unsigned int j = 0, m = planets.size(); j < m; j++)
+		{
+			if (planets[j] == pid)
+			{
+				keys[j] += key;
+				first[j] = i;
+				last[j]  = end;
+			}
+		}
+		i = end;
+	}
+
+	SimCache* cache = SimCache::Instance();
+	Mask missed(copyAP.size(), 0);
+	bool any = false;
+	for (unsigned int i = 0, n = copyAP.size(); i < n; i++)
+	{
+		Planet& p = copyAP[i];
+		History& history = ownershipHistory[p.PlanetID()];
+		keys[i] = SimCache::Horizon(keys[i], totalTurns, SimCache::OUTCOME);
+		const SimCache::Outcome* o = cache->FindOutcome(keys[i]);
+		if (o == NULL)
 		{
+			history.push_back(PlanetOwner(p.Owner(), 0, 0, p.NumShips()));
+			missed[i] = any = true;
 			continue;
 		}
+		p.Owner(o->owner);
+		p.NumShips(o->ships);
+		history.assign(o->history, o->history + o->numHistory);
+	}
+	if (!any)
+	{
+		return;
+	}
 
-		int turnsRemaining = f.TurnsRemaining() - turnsTaken;
-		if ((turnsTaken + turnsRemaining) > totalTurns)
+	Counters::Add(Counters::SIMULATIONS);
+	Counters::Add(Counters::SIMULATED_FLEETS, refAF.size());
+	for (unsigned int i = 0, n = copyAP.size(); i < n; i++)
+	{
+		if (missed[i])
 		{
-			turnsRemaining = totalTurns - turnsTaken;
+			Planet& p = copyAP[i];
+			Land(p, order, first[i], last[i], totalTurns, true);
+			cache->StoreOutcome(keys[i], p, ownershipHistory[p.PlanetID()]);
 		}
-		turnsTaken += turnsRemaining;
+	}
+}
 
-		std::map<int, int> forces;
-		forces[f.Owner()] = f.NumShips();
-		std::vector<int> fleetsWithSameDestAndTurns;
-		fleetsWithSameDestAndTurns.push_back(i);
+int Simulator::StartScore(int totalTurns, PlanetVec& refAP, FleetVec& refAF) {
+	targets.clear();
+	ownershipHistory.clear();
+	base = NULL;
+	AP = NULL;
+	AF = &refAF;
+	counted = true;
 
-		// if the next fleet has the same destination planet AND the same
-		// amount of turns remaining, gather all the forces
-		while (
-			i < n-1 && 
-			AF->at(i+1).DestinationPlanet() == f.DestinationPlanet() &&
-			AF->at(i+1).TurnsRemaining() == f.TurnsRemaining()
-		)
+	SimCache* cache = SimCache::Instance();
+	const unsigned long long key = SimCache::Horizon(SimCache::StateKey(refAP, refAF), totalTurns, SimCache::SCORE);
+	const SimCache::Score* s = cache->FindScore(key);
+	if (s != NULL)
+	{
+		myNumShips    = s->myNumShips;
+		enemyNumShips = s->enemyNumShips;
+		return GetScore();
+	}
+
+	Counters::Add(Counters::SIMULATIONS);
+	Counters::Add(Counters::SIMULATED_FLEETS, refAF.size());
+	myNumShips = enemyNumShips = 0;
+
+	IntVec order;
+	Bucket(1, totalTurns, refAP.size(), NULL, order);
+	int grown = 0;
+	for (unsigned int i = 0, n = order.size(); i < n;)
+	{
+		const int pid = AF->at(order[i]).DestinationPlanet();
+		unsigned int end = i + 1;
+		while (end < n && AF->at(order[end]).DestinationPlanet() == pid)
 		{
-			i++;
-			fleetsWithSameDestAndTurns.push_back(i);
-			if (forces.find(AF->at(i).Owner()) == forces.end())
-			{
-				forces[AF->at(i).Owner()] = 0;
-			}
-			forces[AF->at(i).Owner()] += AF->at(i).NumShips();
+			end++;
+		}
+		for (; grown < pid; grown++)
+		{
+			Count(refAP[grown], totalTurns);
 		}
+		Planet p = refAP[pid];
+		Land(p, order, i, end, totalTurns, false);
+		Count(p);
+		grown = pid + 1;
+		i = end;
+	}
+	for (int n = refAP.size(); grown < n; grown++)
+	{
+		Count(refAP[grown], totalTurns);
+	}
+	CountFleets(totalTurns, false);
+	cache->StoreScore(key, myNumShips, enemyNumShips);
+	return GetScore();
+}
+
+// Resolves the fleets order[begin, end), all heading for p and ordered on
+// turns remaining, and grows p up to the horizon
+void Simulator::Land(Planet& p, const IntVec& order, unsigned int begin, unsigned int end, int totalTurns, bool record) {
+	int turnsTaken = 0;
+	for (unsigned int i = begin; i < end; i++)
+	{
+		const Fleet& f = AF->at(order[i]);
+		int turnsRemaining = f.TurnsRemaining() - turnsTaken;
+		turnsTaken += turnsRemaining;
 
-		// determine wether fleets hit a planet
-		bool impact = false;
-		for (unsigned int j = 0, m = fleetsWithSameDestAndTurns.size(); j < m; j++)
+		// gather the forces of all fleets with the same amount of turns
+		// remaining, ordered on owner
+		Forces forces;
+		forces.Add(f.Owner(), f.NumShips());
+		while (i < end-1 && AF->at(order[i+1]).TurnsRemaining() == f.TurnsRemaining())
 		{
-			Fleet& ff = AF->at(fleetsWithSameDestAndTurns[j]);
-			ff.TurnsRemaining(ff.TurnsRemaining()-turnsTaken);
-			if (ff.TurnsRemaining() <= 0)
-			{
-				remove.push_front(index + j);
-				impact = true;
-			}
+			i++;
+			forces.Add(AF->at(order[i]).Owner(), AF->at(order[i]).NumShips());
 		}
 		
 		// Add ship growth for non-neutral planets
-		Planet& p = AP->at(f.DestinationPlanet());
 		if (p.Owner() > 0)
 		{
 			p.AddShips(turnsRemaining*p.GrowthRate());
@@ -110,106 +258,120 @@ void Simulator::Start(int totalTurns,
 		// If there are more then one force and if all forces are the same
 		// size, the winner is the original planet owner and the new
 		// shipcount is zero
-		if (impact)
+		int forceBegin = forces.force[0];
+		int forceEnd   = forces.force[forces.n-1];
+		if (forces.n > 1 && forceBegin >= p.NumShips() && forceBegin == forceEnd)
 		{
-			int forceBegin = forces.begin()->second;
-			int forceEnd   = (--forces.end())->second;
-			if (forces.size() > 1 && forceBegin >= p.NumShips() && forceBegin == forceEnd)
-			{
-				p.NumShips(0);
-			}
-			else
+			p.NumShips(0);
+		}
+		else
+		{
+			// Determine biggest force
+			int owner = p.Owner();
+			int force = 0;
+			for (int j = 0; j < forces.n; j++)
 			{
-				// Determine biggest force
-				int owner = p.Owner();
-				int force = 0;
-				for (std::map<int,int>::iterator j = forces.begin(); j != forces.end(); j++)
+				if (forces.force[j] > force)
 				{
-					if (j->second > force)
-					{
-						owner = j->first;
-						force = j->second;
-					}
+					owner = forces.owner[j];
+					force = forces.force[j];
 				}
+			}
 
-				// Subtract other forces
-				for (std::map<int,int>::iterator j = forces.begin(); j != forces.end(); j++)
+			// Subtract other forces
+			for (int j = 0; j < forces.n; j++)
+			{
+				if (forces.owner[j] != owner)
 				{
-					if (j->first != owner)
-					{
-						force -= j->second;
-					}
+					force -= forces.force[j];
 				}
+			}
 
-				// Change the planet owner to the biggest force and add it
-				if (p.Owner() == owner)
-				{
-					p.AddShips(force);
-				}
-				else
+			// Change the planet owner to the biggest force and add it
+			if (p.Owner() == owner)
+			{
+				p.AddShips(force);
+			}
+			else
+			{
+				if (force > p.NumShips())
 				{
-					if (force > p.NumShips())
-					{
+					if (record)
 						ChangeOwner(p, owner, turnsTaken, force);
-					}
-					p.NumShips(abs(p.NumShips() - force));
+					else
+						p.Owner(owner);
 				}
+				p.NumShips(abs(p.NumShips() - force));
 			}
 		}
+	}
 
-		// This planet has no more fleets, add additional simulation growth and
-		// reset turns taken
-		if (i == n-1 || AF->at(i+1).DestinationPlanet() != f.DestinationPlanet())
-		{
-			if (turnsTaken < totalTurns && p.Owner() > 0)
-			{
-				p.AddShips((totalTurns-turnsTaken)*p.GrowthRate());
-			}
-			turnsTaken = 0;
-			skipPlanets.push_back(p.PlanetID());
-		}
+	// This planet has no more fleets, add additional simulation growth
+	if (turnsTaken < totalTurns && p.Owner() > 0)
+	{
+		p.AddShips((totalTurns-turnsTaken)*p.GrowthRate());
 	}
+}
 
-	// TODO: Optimize
-	if (removeFleets)
+// p as it is after growing for turns, when owned
+void Simulator::Count(const Planet& p, int turns) {
+	if (p.Owner() == 1)
 	{
-		typedef std::list<unsigned int>::iterator Iter;
-		for (Iter i = remove.begin(); i != remove.end(); i++)
-		{
-			AF->erase(AF->begin()+(*i));
-		}
+		myNumShips += p.NumShips() + p.GrowthRate()*turns;
+	}
+	else if (p.Owner() > 1)
+	{
+		enemyNumShips += p.NumShips() + p.GrowthRate()*turns;
 	}
+}
 
-	// calculate the score components (myNumShips, enemyNumShips)
-	// and add additional growthrate to planets
-	for (unsigned int i = 0, n = AP->size(); i < n; i++)
+// grows the planets [begin, end) in place, no fleet lands on them
+void Simulator::Grow(int begin, int end, int turns) {
+	for (int i = begin; i < end; i++)
 	{
 		Planet& p = AP->at(i);
-		if (p.Owner() != 0 && find(skipPlanets.begin(), skipPlanets.end(), p.PlanetID()) == skipPlanets.end())
+		if (p.Owner() != 0)
 		{
-			p.AddShips(p.GrowthRate()*totalTurns);
+			p.AddShips(p.GrowthRate()*turns);
 		}
+		Count(p);
+	}
+}
 
-		if (p.Owner() == 1)
+// the score of a copy, the planets no fleet landed on as they grow. The
+// slots are on planet.
+void Simulator::CountScore() {
+	if (counted)
+	{
+		return;
+	}
+	counted = true;
+	SlotMap::const_iterator s = slots.begin();
+	for (int i = 0, n = base->size(); i < n; i++)
+	{
+		if (s != slots.end() && s->first == i)
 		{
-			myNumShips += p.NumShips();
+			Count(copyAP[s->second]);
+			++s;
 		}
-		else if (p.Owner() > 1)
+		else
 		{
-			enemyNumShips += p.NumShips();
+			Count(base->at(i), horizon);
 		}
 	}
+	CountFleets(horizon, false);
+}
 
+// the fleets that did not land
+void Simulator::CountFleets(int totalTurns, bool removeFleets) {
 	for (unsigned int i = 0, n = AF->size(); i < n; i++)
 	{
-		Fleet& f = AF->at(i);
-
-		if (f.TurnsRemaining() <= 0 && removeFleets) 
+		const Fleet& f = AF->at(i);
+		if (f.TurnsRemaining() <= 0 && removeFleets)
 		{
 			ASSERT(f.TurnsRemaining() > 0);
 		}
-		else
-		if (f.TurnsRemaining() <= 0)
+		if (f.TurnsRemaining() <= 0 || f.TurnsRemaining() <= totalTurns)
 		{
 			continue;
 		}
@@ -225,18 +387,225 @@ void Simulator::Start(int totalTurns,
 	}
 }
 
-std::vector<Simulator::PlanetOwner>& Simulator::GetOwnershipHistory(int i) { 
+// Fleet indices with lo <= turns remaining <= hi, heading for one of the
+// planets when given, ordered on destination planet and turns remaining.
+// With a base bound to the fleets the ones it indexed are looked up per
+// planet and the ones added since merged in. Otherwise two stable counting
+// sorts, first on the turns and then on the destination, in the buckets of
+// the destination x turns grid.
+void Simulator::Bucket(int lo, int hi, int numPlanets, const IntVec* planets, IntVec& order) {
+	const FleetVec& F = *AF;
+	order.clear();
+	if (hi < lo)
+	{
+		return;
+	}
+
+	const SimBase* base = SimBase::Instance(F);
+	if (base != NULL)
+	{
+		IntVec sorted;
+		if (planets != NULL)
+		{
+			sorted = *planets;
+			std::sort(sorted.begin(), sorted.end());
+			sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+		}
+		if (planets == NULL)
+		{
+			base->Landing(lo, hi, order);
+		}
+		for (unsigned int i = 0, n = sorted.size(); i < n; i++)
+		{
+			base->Landing(sorted[i], lo, hi, order);
+		}
+
+		IntVec added;
+		for (unsigned int i = base->NumFleets(), n = F.size(); i < n; i++)
+		{
+			const int t = F[i].TurnsRemaining();
+			if (t >= lo && t <= hi &&
+				(planets == NULL || std::binary_search(sorted.begin(), sorted.end(), F[i].DestinationPlanet())))
+			{
+				added.push_back(i);
+			}
+		}
+		if (!added.empty())
+		{
+			const OnDestinationAndTurns less(F);
+			std::stable_sort(added.begin(), added.end(), less);
+			IntVec indexed;
+			indexed.swap(order);
+			order.resize(indexed.size() + added.size());
+			std::merge(indexed.begin(), indexed.end(), added.begin(), added.end(), order.begin(), less);
+		}
+		return;
+	}
+
+	Mask wanted;
+	if (planets != NULL)
+	{
+		wanted.assign(numPlanets, 0);
+		for (unsigned int i = 0, n = planets->size(); i < n; i++)
+		{
+			wanted[(*planets)[i]] = 1;
+		}
+	}
+
+	IntVec turns(hi - lo + 2, 0);
+	for (unsigned int i = 0, n = F.size(); i < n; i++)
+	{
+		const int t = F[i].TurnsRemaining();
+		if (t >= lo && t <= hi && (planets == NULL || wanted[F[i].DestinationPlanet()]))
+		{
+			turns[t - lo + 1]++;
+		}
+	}
+	for (unsigned int t = 1, n = turns.size(); t < n; t++)
+	{
+		turns[t] += turns[t-1];
+	}
+	if (turns.back() == 0)
+	{
+		return;
+	}
+
+	IntVec byTurns(turns.back());
+	IntVec dests(numPlanets + 1, 0);
+	for (unsigned int i = 0, n = F.size(); i < n; i++)
+	{
+		const int t = F[i].TurnsRemaining();
+		if (t >= lo && t <= hi && (planets == NULL || wanted[F[i].DestinationPlanet()]))
+		{
+			byTurns[turns[t - lo]++] = i;
+			dests[F[i].DestinationPlanet() + 1]++;
+		}
+	}
+	for (unsigned int d = 1, n = dests.size(); d < n; d++)
+	{
+		dests[d] += dests[d-1];
+	}
+
+	order.resize(byTurns.size());
+	for (unsigned int i = 0, n = byTurns.size(); i < n; i++)
+	{
+		order[dests[F[byTurns[i]].DestinationPlanet()]++] = byTurns[i];
+	}
+}
+
+// Moves the fleets on in place, in the order of the simulation, and drops the
+// fleets that landed when asked to.
+void Simulator::Advance(int totalTurns, bool removeFleets) {
+	FleetVec& F = *AF;
+	int lo = 0, hi = 0;
+	for (unsigned int i = 0, n = F.size(); i < n; i++)
+	{
+		lo = (i == 0)? F[i].TurnsRemaining(): std::min(lo, F[i].TurnsRemaining());
+		hi = (i == 0)? F[i].TurnsRemaining(): std::max(hi, F[i].TurnsRemaining());
+	}
+	IntVec order;
+	Bucket(lo, hi, AP->size(), NULL, order);
+
+	copyAF = F;
+	F.clear();
+	for (unsigned int i = 0, n = order.size(); i < n; i++)
+	{
+		Fleet f = copyAF[order[i]];
+		const int turns = f.TurnsRemaining();
+		if (turns > 0)
+		{
+			f.TurnsRemaining(turns - ((turns <= totalTurns)? turns: totalTurns));
+			if (f.TurnsRemaining() <= 0 && removeFleets)
+			{
+				continue;
+			}
+		}
+		F.push_back(f);
+	}
+}
+
+// copies planet i of the base into the overlay
+Planet& Simulator::Materialize(int i) {
+	ASSERT(copyAP.size() < copyAP.capacity());
+	slots.insert(slots.end(), std::make_pair(i, int(copyAP.size())));
+	copyAP.push_back(base->at(i));
+	return copyAP.back();
+}
+
+Planet& Simulator::GetPlanet(int i) {
+	if (base != NULL)
+	{
+		SlotMap::const_iterator s = slots.find(i);
+		if (s != slots.end())
+		{
+			return copyAP[s->second];
+		}
+
+		// no fleet landed, it just grew
+		Planet& p = Materialize(i);
+		if (p.Owner() != 0)
+		{
+			p.AddShips(p.GrowthRate()*horizon);
+		}
+		return p;
+	}
+
+	if (targets.empty())
+	{
+		return AP->at(i);
+	}
+
+	for (unsigned int j = 0, n = targets.size(); j < n; j++)
+	{
+		if (targets[j] == i)
+		{
+			return AP->at(j);
+		}
+	}
+	ASSERT_MSG(false, "Planet " << i << " was not simulated");
+	return AP->at(0);
+}
+
+Simulator::History& Simulator::GetOwnershipHistory(int i) { 
+	if (base != NULL && ownershipHistory.find(i) == ownershipHistory.end())
+	{
+		// no fleet landed, the owner did not change
+		const Planet& p = base->at(i);
+		ownershipHistory[i].push_back(PlanetOwner(p.Owner(), 0, 0, p.NumShips()));
+	}
 	ASSERT(ownershipHistory.find(i) != ownershipHistory.end());
 	return ownershipHistory[i]; 
 }
 
+void Simulator::Forces::Add(int o, int f) {
+	int i = 0;
+	while (i < n && owner[i] < o)
+	{
+		i++;
+	}
+	if (i < n && owner[i] == o)
+	{
+		force[i] += f;
+		return;
+	}
+	ASSERT(n < MAX_FORCES);
+	for (int j = n; j > i; j--)
+	{
+		owner[j] = owner[j-1];
+		force[j] = force[j-1];
+	}
+	owner[i] = o;
+	force[i] = f;
+	n++;
+}
+
 void Simulator::ChangeOwner(Planet& p, int owner, int time, int force) {
 	ownershipHistory[p.PlanetID()].push_back(PlanetOwner(owner,time,force,p.NumShips()));
 	p.Owner(owner);
 }
 
 Simulator::PlanetOwner& Simulator::GetFirstEnemyOwner(int i) {
-	std::vector<Simulator::PlanetOwner>& H = GetOwnershipHistory(i);
+	History& H = GetOwnershipHistory(i);
 	for (unsigned int j = 0, n = H.size(); j < n; j++)
 	{
 		if (H[j].owner > 1)
@@ -244,6 +613,6 @@ Simulator::PlanetOwner& Simulator::GetFirstEnemyOwner(int i) {
 			return H[j];
 		}
 	}
-	ASSERT_MSG(false, "No enemy owner exists for planet " << AP->at(i));
+	ASSERT_MSG(false, "No enemy owner exists for planet " << GetPlanet(i));
 	return H.front();
 }
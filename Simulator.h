@@ -11,7 +11,10 @@ class Simulator {
 public:
 	Simulator():
 		myNumShips(0),
-		enemyNumShips(0)
+		enemyNumShips(0),
+		horizon(0),
+		counted(true),
+		base(NULL)
 	{
 	}
 
@@ -29,29 +32,84 @@ public:
 		int numships; // numships on planet before impact
 	};
 
-	void Start(int, std::vector<Planet>&, std::vector<Fleet>&, bool removeFleets = true, bool makeCopy = false);
-	std::vector<PlanetOwner>& GetOwnershipHistory(int i);
+	typedef std::vector<PlanetOwner, ArenaAllocator<PlanetOwner> > History;
+
+	// With makeCopy the planets passed are left as they are, the results are
+	// an overlay on them in which only the planets that fleets land on are
+	// copied, and the score is counted when first asked for. It is valid
+	// until the next Start and while the planets and fleets passed do not
+	// change.
+	void Start(int, PlanetVec&, FleetVec&, bool removeFleets = true, bool makeCopy = false);
+
+	// Simulate only the given planets on a copy of them, just the fleets
+	// heading for them are resolved. Only GetPlanet(), the histories and the
+	// planet queries of these planets are valid afterwards, there is no score.
+	void StartPlanet(int, PlanetVec&, FleetVec&, int planet);
+	void StartPlanets(int, PlanetVec&, FleetVec&, const IntVec& planets);
+
+	// Only the score, nothing is copied and no history is kept. Returns
+	// GetScore().
+	int StartScore(int, PlanetVec&, FleetVec&);
+
+	History& GetOwnershipHistory(int i);
 	PlanetOwner& GetFirstEnemyOwner(int i);
 
-	bool Winning()					{ return myNumShips > enemyNumShips; }
-	bool IsNeutralPlanet(int i) 	{ return AP->at(i).Owner() == 0; }
-	bool IsMyPlanet(int i) 			{ return AP->at(i).Owner() == 1; }
-	bool IsEnemyPlanet(int i) 		{ return AP->at(i).Owner() > 1; }
-	int MyNumShips()				{ return myNumShips; }
-	int EnemyNumShips()				{ return enemyNumShips; }
-	int GetScore()					{ return myNumShips - enemyNumShips; }
-	Planet& GetPlanet(int i)		{ return AP->at(i); }
+	bool Winning()					{ CountScore(); return myNumShips > enemyNumShips; }
+	bool IsNeutralPlanet(int i) 	{ return GetPlanet(i).Owner() == 0; }
+	bool IsMyPlanet(int i) 			{ return GetPlanet(i).Owner() == 1; }
+	bool IsEnemyPlanet(int i) 		{ return GetPlanet(i).Owner() > 1; }
+	int MyNumShips()				{ CountScore(); return myNumShips; }
+	int EnemyNumShips()				{ CountScore(); return enemyNumShips; }
+	int GetScore()					{ CountScore(); return myNumShips - enemyNumShips; }
+	Planet& GetPlanet(int i);
 
 private:
 	int myNumShips;
 	int enemyNumShips;
-	std::vector<Planet> copyAP; // local deepcopy of all planets
-	std::vector<Fleet> copyAF;  // local deepcopy of all fleets
-	std::vector<Planet>* AP; // active planets, either from the deepcopy or passed by reference from Start()
-	std::vector<Fleet>* AF;  // active fleets, either from the deepcopy or passed by reference from Start()
-	std::map<int, std::vector<PlanetOwner> > ownershipHistory; // history record of fleet impacts in a planet
+	int horizon;
+	bool counted; // myNumShips and enemyNumShips, a copy counts them when asked for
+	typedef std::map<int, int, std::less<int>, ArenaAllocator<std::pair<const int, int> > > SlotMap;
+	const PlanetVec* base; // planets under the copy of Start(), NULL when there is none
+	SlotMap    slots;  // the planets of base copied so far, to their index in copyAP
+	PlanetVec  copyAP; // copies of the simulated planets
+	FleetVec   copyAF; // fleets before an in place Advance()
+	IntVec     targets; // planets simulated by StartPlanets(), in the order of copyAP
+	PlanetVec* AP;     // active planets, either the copies or passed by reference to Start()
+	FleetVec*  AF;     // fleets passed by reference to Start(), only changed when not making a copy
+	std::map<int, History, std::less<int>, ArenaAllocator<std::pair<const int, History> > >
+		ownershipHistory; // history record of fleet impacts in a planet
+
+	typedef std::vector<char, ArenaAllocator<char> > Mask;
+	typedef std::vector<unsigned long long, ArenaAllocator<unsigned long long> > KeyVec;
+
+	// forces of the fleets landing in one turn, ordered on owner
+	enum { MAX_FORCES = 8 };
+	struct Forces {
+		Forces(): n(0) {}
+		void Add(int owner, int force);
+		int owner[MAX_FORCES];
+		int force[MAX_FORCES];
+		int n;
+	};
+
+	struct OnDestinationAndTurns {
+		OnDestinationAndTurns(const FleetVec& F): AF(F) {}
+		bool operator()(int a, int b) const {
+			return AF[a].DestinationPlanet() < AF[b].DestinationPlanet() ||
+				(AF[a].DestinationPlanet() == AF[b].DestinationPlanet() && AF[a].TurnsRemaining() < AF[b].TurnsRemaining());
+		}
+		const FleetVec& AF;
+	};
 
 	void ChangeOwner(Planet& p, int owner, int time, int force);
+	void Land(Planet& p, const IntVec& order, unsigned int begin, unsigned int end, int totalTurns, bool record);
+	void Count(const Planet& p, int turns = 0);
+	void Grow(int begin, int end, int turns);
+	void CountScore();
+	void CountFleets(int totalTurns, bool removeFleets);
+	void Bucket(int lo, int hi, int numPlanets, const IntVec* planets, IntVec& order);
+	void Advance(int totalTurns, bool removeFleets);
+	Planet& Materialize(int i);
 };
 
 #endif
@@ -0,0 +1,116 @@
+#include "Strength.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+// A fleet to planet p counts when it lands within dist - distance(p) turns
+// and p lies within dist, so at the turn distance(p) + turns, but no sooner
+// than distance(p) + 1.
+Strength::Strength(const PlanetVec& refAP, const FleetVec& AF, const IntVec& t, const IntVec& PIDX, const IntVec& FIDX):
+	AP(refAP),
+	targets(t),
+	slot(refAP.size(), -1)
+{
+	IntVec fleetsTo(AP.size() + 1, 0); // counting sort of FIDX on destination
+	for (unsigned int j = 0, m = FIDX.size(); j < m; j++)
+		fleetsTo[AF[FIDX[j]].DestinationPlanet() + 1]++;
+	for (unsigned int i = 1, n = fleetsTo.size(); i < n; i++)
+		fleetsTo[i] += fleetsTo[i-1];
+	IntVec sorted(FIDX.size());
+	{
+		IntVec next(fleetsTo.begin(), fleetsTo.end() - 1);
+		for (unsigned int j = 0, m = FIDX.size(); j < m; j++)
+			sorted[next[AF[FIDX[j]].DestinationPlanet()]++] = FIDX[j];
+	}
+
+	std::vector<std::pair<int, int> > near, arrive; // (distance, pid), (turn, ships)
+	planets.push_back(0);
+	fleets.push_back(0);
+	for (unsigned int k = 0, n = targets.size(); k < n; k++)
+	{
+		const Planet& target = AP[targets[k]];
+		const int tid = target.PlanetID();
+		slot[tid] = k;
+
+		near.clear();
+		arrive.clear();
+		for (unsigned int i = 0, m = PIDX.size(); i < m; i++)
+		{
+			const int pid = PIDX[i];
+			if (pid == tid)
+				continue;
+
+			const int d = target.Distance(AP[pid]);
+			near.push_back(std::make_pair(d, pid));
+			for (int j = fleetsTo[pid]; j < fleetsTo[pid+1]; j++)
+			{
+				const Fleet& f = AF[sorted[j]];
+				arrive.push_back(std::make_pair(std::max(d + f.TurnsRemaining(), d + 1), f.NumShips()));
+			}
+		}
+		sort(near.begin(), near.end());
+		sort(arrive.begin(), arrive.end());
+
+		int s = 0, g = 0, gd = 0;
+		for (unsigned int i = 0, m = near.size(); i < m; i++)
+		{
+			const Planet& p = AP[near[i].second];
+			distances.push_back(near[i].first);
+			ships.push_back(s);
+			growth.push_back(g);
+			growthTimesDistance.push_back(gd);
+			s  += p.NumShips();
+			g  += p.GrowthRate();
+			gd += p.GrowthRate() * near[i].first;
+		}
+		distances.push_back(std::numeric_limits<int>::max());
+		ships.push_back(s);
+		growth.push_back(g);
+		growthTimesDistance.push_back(gd);
+		planets.push_back(distances.size());
+
+		int a = 0;
+		for (unsigned int i = 0, m = arrive.size(); i < m; i++)
+		{
+			turns.push_back(arrive[i].first);
+			arrivals.push_back(a);
+			a += arrive[i].second;
+		}
+		turns.push_back(std::numeric_limits<int>::max());
+		arrivals.push_back(a);
+		fleets.push_back(turns.size());
+	}
+}
+
+// the planets closer than dist bring their ships and what they grow until
+// dist, the fleets the ships that land in time
+int Strength::Get(int tid, int dist) const {
+	const int k = slot[tid];
+	ASSERT(k != -1);
+	const int p = lower_bound(distances.begin() + planets[k], distances.begin() + planets[k+1] - 1, dist) - distances.begin();
+	const int f = upper_bound(turns.begin() + fleets[k], turns.begin() + fleets[k+1] - 1, dist) - turns.begin();
+	return ships[p] + dist*growth[p] - growthTimesDistance[p] + arrivals[f];
+}
+
+int Strength::Weakest(int sid, const PlanetSet* skip) const {
+	const Planet& source = AP[sid];
+	int weakest = std::numeric_limits<int>::max();
+	int bestTarget = -1;
+	for (unsigned int k = 0, n = targets.size(); k < n; k++)
+	{
+		const Planet& target = AP[targets[k]];
+		const int tid = target.PlanetID();
+		if (skip != NULL && skip->Has(tid))
+			continue;
+
+		const int strength = Get(tid, target.Distance(source)) + target.NumShips();
+		if (strength < weakest)
+		{
+			weakest = strength;
+			bestTarget = tid;
+		}
+	}
+	return bestTarget;
+}
@@ -0,0 +1,35 @@
+#ifndef STRENGTH_
+#define STRENGTH_
+
+#include "PlanetWars.h"
+#include "PlanetSet.h"
+
+// GetStrength of every target at once: the ships the planets PIDX and the
+// fleets FIDX heading for them bring to a target within dist turns. Per
+// target the other planets are sorted on their distance to it and the
+// fleets on the turn their ships would reach it, both with prefix sums. A
+// query is then two binary searches instead of a scan of all planets and
+// fleets, so picking the weakest target of every source costs the targets
+// per source. Holds for the state it was built on.
+class Strength {
+public:
+	Strength(const PlanetVec& AP, const FleetVec& AF, const IntVec& targets, const IntVec& PIDX, const IntVec& FIDX);
+
+	// GetStrength(tid, dist, PIDX, FIDX) for one of the targets
+	int Get(int tid, int dist) const;
+
+	// the target with the least ships around it as seen from sid, the first
+	// in the order of the targets on a tie, -1 when all are skipped
+	int Weakest(int sid, const PlanetSet* skip) const;
+
+private:
+	const PlanetVec& AP;
+	const IntVec&    targets;
+	IntVec slot;    // per planet its index in targets, -1 for the others
+	IntVec planets; // per target [planets[slot], planets[slot+1]) in distances and the sums
+	IntVec fleets;  // per target [fleets[slot], fleets[slot+1]) in turns and arrivals
+	IntVec distances, ships, growth, growthTimesDistance; // the sums hold the planets before
+	IntVec turns, arrivals;
+};
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef THREADKEY_
+#define THREADKEY_
+
+#include <pthread.h>
+
+// A key whose destroy function runs on the value of a thread when it exits,
+// for the per-thread instances that are created on first use. Allocates
+// nothing, so operator new may use it.
+inline pthread_key_t NewKey(void (*destroy)(void*)) {
+	pthread_key_t key;
+	pthread_key_create(&key, destroy);
+	return key;
+}
+
+#endif
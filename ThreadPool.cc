@@ -0,0 +1,141 @@
+#include "ThreadPool.h"
+
+#include <unistd.h>
+
+ThreadPool::ThreadPool(int numThreads):
+	queued(0),
+	pending(0),
+	quit(false),
+	next(0)
+{
+	pthread_mutex_init(&lock, NULL);
+	pthread_cond_init(&work, NULL);
+	pthread_cond_init(&done, NULL);
+
+	for (int i = 0; i < numThreads; i++)
+	{
+		Worker* w = new Worker();
+		w->pool = this;
+		w->id   = i;
+		pthread_mutex_init(&w->lock, NULL);
+		workers.push_back(w);
+	}
+
+	for (int i = 0; i < numThreads; i++)
+		pthread_create(&workers[i]->thread, NULL, Main, workers[i]);
+}
+
+ThreadPool::~ThreadPool() {
+	pthread_mutex_lock(&lock);
+	quit = true;
+	pthread_cond_broadcast(&work);
+	pthread_mutex_unlock(&lock);
+
+	for (unsigned int i = 0, n = workers.size(); i < n; i++)
+	{
+		pthread_join(workers[i]->thread, NULL);
+		pthread_mutex_destroy(&workers[i]->lock);
+		delete workers[i];
+	}
+
+	pthread_cond_destroy(&done);
+	pthread_cond_destroy(&work);
+	pthread_mutex_destroy(&lock);
+}
+
+int ThreadPool::NumCores() {
+	const long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return (n < 1)? 1: int(n);
+}
+
+void ThreadPool::Submit(Task* task) {
+	pthread_mutex_lock(&lock);
+	__atomic_add_fetch(&pending, 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&lock);
+
+	Worker* w = workers[next++ % workers.size()];
+	pthread_mutex_lock(&w->lock);
+	w->tasks.push_back(task);
+	pthread_mutex_unlock(&w->lock);
+
+	// queued may briefly drop below zero when the task is taken before this
+	pthread_mutex_lock(&lock);
+	__sync_fetch_and_add(&queued, 1);
+	pthread_cond_signal(&work);
+	pthread_mutex_unlock(&lock);
+}
+
+void ThreadPool::Wait(int below) {
+	pthread_mutex_lock(&lock);
+	while (pending >= below)
+		pthread_cond_wait(&done, &lock);
+	pthread_mutex_unlock(&lock);
+}
+
+// the owner works LIFO on its own queue
+Task* ThreadPool::Pop(int id) {
+	Worker* w = workers[id];
+	Task* task = NULL;
+	pthread_mutex_lock(&w->lock);
+	if (!w->tasks.empty())
+	{
+		task = w->tasks.back();
+		w->tasks.pop_back();
+	}
+	pthread_mutex_unlock(&w->lock);
+	return task;
+}
+
+// thieves take the oldest task of another worker
+Task* ThreadPool::Steal(int id) {
+	for (unsigned int i = 1, n = workers.size(); i < n; i++)
+	{
+		Worker* w = workers[(id + i) % n];
+		Task* task = NULL;
+		pthread_mutex_lock(&w->lock);
+		if (!w->tasks.empty())
+		{
+			task = w->tasks.front();
+			w->tasks.pop_front();
+		}
+		pthread_mutex_unlock(&w->lock);
+		if (task != NULL)
+			return task;
+	}
+	return NULL;
+}
+
+void ThreadPool::Loop(Worker* w) {
+	while (true)
+	{
+		Task* task = Pop(w->id);
+		if (task == NULL)
+			task = Steal(w->id);
+
+		if (task != NULL)
+		{
+			__sync_fetch_and_sub(&queued, 1);
+			task->Run(w->id);
+
+			pthread_mutex_lock(&lock);
+			__atomic_sub_fetch(&pending, 1, __ATOMIC_RELEASE);
+			pthread_cond_broadcast(&done);
+			pthread_mutex_unlock(&lock);
+			continue;
+		}
+
+		pthread_mutex_lock(&lock);
+		while (__atomic_load_n(&queued, __ATOMIC_RELAXED) <= 0 && !quit)
+			pthread_cond_wait(&work, &lock);
+		const bool stop = quit;
+		pthread_mutex_unlock(&lock);
+		if (stop)
+			return;
+	}
+}
+
+void* ThreadPool::Main(void* arg) {
+	Worker* w = static_cast<Worker*>(arg);
+	w->pool->Loop(w);
+	return NULL;
+}
@@ -0,0 +1,58 @@
+#ifndef THREADPOOL_
+#define THREADPOOL_
+
+#include <pthread.h>
+#include <deque>
+#include <vector>
+
+// Unit of work for the pool, the same task may be submitted multiple times
+class Task {
+public:
+	virtual ~Task() {}
+	virtual void Run(int worker) = 0;
+};
+
+// Fixed size pool of worker threads. Every worker has its own queue, tasks
+// are handed out round robin and a worker that runs out of work steals from
+// the front of the other queues. The queues are deques under a mutex each,
+// not lock free, a task is a batch of work so the locks are taken rarely.
+class ThreadPool {
+public:
+	ThreadPool(int numThreads = NumCores());
+	~ThreadPool();
+
+	void Submit(Task*);
+	// blocks until fewer than below tasks are pending, all are done by default
+	void Wait(int below = 1);
+
+	int NumThreads() const { return workers.size(); }
+	int Pending() const    { return __atomic_load_n(&pending, __ATOMIC_ACQUIRE); } // submitted but not finished
+
+	static int NumCores();
+
+private:
+	struct Worker {
+		ThreadPool*       pool;
+		int               id;
+		pthread_t         thread;
+		pthread_mutex_t   lock;
+		std::deque<Task*> tasks;
+	};
+
+	std::vector<Worker*> workers;
+	pthread_mutex_t lock;
+	pthread_cond_t  work; // signalled when tasks are queued
+	pthread_cond_t  done; // signalled when a task finishes
+	volatile int    queued;
+	int             pending; // changed under the lock
+	volatile bool   quit;
+	unsigned int    next;
+
+	Task* Pop(int);
+	Task* Steal(int);
+	void  Loop(Worker*);
+
+	static void* Main(void*);
+};
+
+#endif
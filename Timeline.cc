@@ -0,0 +1,116 @@
+#include "Timeline.h"
+#include "Counters.h"
+
+Timeline::Timeline():
+	turn(-1),
+	end(-1)
+{}
+
+__thread Timeline* Timeline::current = NULL;
+
+Timeline* Timeline::Instance() {
+	static Timeline timeline;
+	return (current != NULL)? current: &timeline;
+}
+
+void Timeline::Update(PlanetVec& AP, FleetVec& AF, int t, int e, const PlanetWars::ChangeSet* changes) {
+	const bool follows = changes != NULL && !changes->full && t == turn + 1 && e == end &&
+		planets.size() == AP.size();
+	turn = t;
+	end  = e;
+
+	// a fleet of one turn lands before it is seen, it shows in the planets
+	// that differ from what was expected for this turn
+	IntVec targets;
+	if (follows)
+	{
+		for (unsigned int i = 0, n = AP.size(); i < n; i++)
+		{
+			const Projection& p = planets[i];
+			if (touched[i] || AP[i].Owner() != p.nextOwner || AP[i].NumShips() != p.nextNumShips)
+			{
+				targets.push_back(i);
+				touched[i] = 1;
+			}
+		}
+		for (unsigned int i = 0, n = changes->new_fleets.size(); i < n; i++)
+		{
+			const Fleet& f = AF[changes->new_fleets[i]];
+			Touch(f.SourcePlanet(), targets);
+			Touch(f.DestinationPlanet(), targets);
+		}
+	}
+	else
+	{
+		planets.assign(AP.size(), Projection());
+		for (unsigned int i = 0, n = AP.size(); i < n; i++)
+			targets.push_back(i);
+	}
+	touched.assign(AP.size(), 0);
+
+	Simulator next;
+	next.Start(1, AP, AF, false, true);
+	for (unsigned int i = 0, n = AP.size(); i < n; i++)
+	{
+		planets[i].nextOwner    = next.GetPlanet(i).Owner();
+		planets[i].nextNumShips = next.GetPlanet(i).NumShips();
+	}
+	if (targets.empty())
+		return;
+
+	// the planets are independent, all of them at once are one full
+	// simulation
+	Simulator sim;
+	if (targets.size() == AP.size())
+		sim.Start(end - turn, AP, AF, false, true);
+	else
+		sim.StartPlanets(end - turn, AP, AF, targets);
+	Counters::Add(Counters::PROJECTED_PLANETS, targets.size());
+
+	for (unsigned int i = 0, n = targets.size(); i < n; i++)
+	{
+		Projection& p = planets[targets[i]];
+		const Planet& q = sim.GetPlanet(targets[i]);
+		const Simulator::History& history = sim.GetOwnershipHistory(targets[i]);
+		p.owner    = q.Owner();
+		p.numShips = q.NumShips();
+		p.history.assign(history.begin(), history.end());
+		for (unsigned int j = 0, m = p.history.size(); j < m; j++)
+			p.history[j].time += turn;
+	}
+}
+
+void Timeline::Sent(const FleetVec& orders) {
+	if (touched.size() != planets.size())
+		return;
+	for (unsigned int i = 0, n = orders.size(); i < n; i++)
+	{
+		touched[orders[i].SourcePlanet()] = 1;
+		touched[orders[i].DestinationPlanet()] = 1;
+	}
+}
+
+// the events up to the turn of the last update took place, a planet that
+// was not projected again since has the owner and ships it was projected
+// to have then
+Simulator::PlanetOwner Timeline::GetFirstEnemyOwner(const PlanetVec& AP, int i) const {
+	const Planet& p = AP[i];
+	if (p.Owner() > 1)
+		return Simulator::PlanetOwner(p.Owner(), 0, 0, p.NumShips());
+
+	const std::vector<Simulator::PlanetOwner>& history = planets[i].history;
+	for (unsigned int j = 0, n = history.size(); j < n; j++)
+	{
+		const Simulator::PlanetOwner& o = history[j];
+		if (o.time > turn && o.owner > 1)
+			return Simulator::PlanetOwner(o.owner, o.time - turn, o.force, o.numships);
+	}
+	ASSERT_MSG(false, "No enemy owner exists for planet " << p);
+	return Simulator::PlanetOwner(p.Owner(), 0, 0, p.NumShips());
+}
+
+void Timeline::Touch(int i, IntVec& targets) {
+	if (!touched[i])
+		targets.push_back(i);
+	touched[i] = 1;
+}
@@ -0,0 +1,62 @@
+#ifndef TIMELINE_
+#define TIMELINE_
+
+#include "PlanetWars.h"
+#include "Simulator.h"
+
+#include <vector>
+
+// The projection of every planet to the end of the game, kept from one turn
+// to the next. The fleets of the game fly on and land as projected, so a
+// planet only needs a new projection when a fleet was launched from it or
+// to it since its last one: by us, as recorded by Sent, or by the enemy, as
+// found by PlanetWars::Update, or when it is not in the state that was
+// expected for the turn, after a fleet that landed within a turn. The
+// others keep theirs, with the events that took place since left out.
+// Times are kept as turns of the game.
+class Timeline {
+public:
+	Timeline();
+
+	// the timeline of the game played on this thread, a shared one unless
+	// SetInstance gave the thread its own
+	static Timeline* Instance();
+	static void      SetInstance(Timeline* timeline) { current = timeline; }
+
+	// Projects the state of turn t to the end turn. With the changes of
+	// the state that follows the last update only the planets they touch
+	// are projected again, without them all planets are.
+	void Update(PlanetVec& AP, FleetVec& AF, int t, int end, const PlanetWars::ChangeSet* changes);
+
+	// the orders sent in the turn of the last update
+	void Sent(const FleetVec& orders);
+
+	int  GetOwner(int i) const     { return planets[i].owner; }
+	int  GetNumShips(int i) const  { return planets[i].numShips; }
+	bool IsMyPlanet(int i) const    { return planets[i].owner == 1; }
+	bool IsEnemyPlanet(int i) const { return planets[i].owner > 1; }
+
+	// the first enemy owner of planet i of the state of the last update,
+	// its time relative to that turn
+	Simulator::PlanetOwner GetFirstEnemyOwner(const PlanetVec& AP, int i) const;
+
+private:
+	struct Projection {
+		int owner; // at the end
+		int numShips;
+		int nextOwner; // expected in the turn after the last update
+		int nextNumShips;
+		std::vector<Simulator::PlanetOwner> history; // the impacts, at turns of the game
+	};
+
+	std::vector<Projection> planets;
+	std::vector<char>       touched; // to project again on the next update
+	int turn;
+	int end;
+
+	static __thread Timeline* current;
+
+	void Touch(int i, IntVec& targets);
+};
+
+#endif
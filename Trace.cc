@@ -0,0 +1,377 @@
+#include "Trace.h"
+#include "Logger.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define KEYFRAME     16
+#define VERSION      1
+#define HEADER_SIZE  8
+#define PLANET_SIZE  20 // static planet data in the header
+#define FLEET_SIZE   17
+#define RECORD_SIZE  17 // record without planets, fleets and orders
+
+template<typename T> static void Put(std::vector<char>& b, T v) {
+	const char* p = reinterpret_cast<const char*>(&v);
+	b.insert(b.end(), p, p + sizeof(T));
+}
+
+template<typename T> static void Patch(std::vector<char>& b, size_t at, T v) {
+	memcpy(&b[at], &v, sizeof(T));
+}
+
+template<typename T> static T Get(const char*& p) {
+	T v;
+	memcpy(&v, p, sizeof(T));
+	p += sizeof(T);
+	return v;
+}
+
+TraceWriter::TraceWriter(const char* path):
+	end(0),
+	numOrders(0),
+	numPlanets(-1)
+{
+	file = fopen(path, "wb");
+}
+
+TraceWriter::~TraceWriter() {
+	if (file != NULL)
+		fclose(file);
+}
+
+void TraceWriter::BeginTurn(int turn, const PlanetVec& AP, const FleetVec& AF) {
+	if (file == NULL)
+		return;
+
+	if (numPlanets == -1)
+	{
+		Buffer header;
+		header.insert(header.end(), "PWTR", "PWTR" + 4);
+		Put<unsigned short>(header, VERSION);
+		Put<unsigned short>(header, AP.size());
+		for (unsigned int i = 0, n = AP.size(); i < n; i++)
+		{
+			Put<double>(header, AP[i].X());
+			Put<double>(header, AP[i].Y());
+			Put<int>(header, AP[i].GrowthRate());
+		}
+		fwrite(&header[0], 1, header.size(), file);
+		end = header.size();
+		numPlanets = AP.size();
+		owners.assign(numPlanets, -1);
+		ships.assign(numPlanets, -1);
+	}
+	ASSERT(int(AP.size()) == numPlanets);
+
+	// deltas need the fleets of the previous turn one turn closer
+	bool keyframe = offsets.size() % KEYFRAME == 0;
+	std::map<int, int> current;
+	for (unsigned int i = 0, n = AF.size(); i < n; i++)
+	{
+		const Fleet& f = AF[i];
+		std::map<int, int>::iterator j = fleets.find(f.FleetID());
+		if (f.FleetID() < 0 || (j != fleets.end() && j->second - 1 != f.TurnsRemaining()))
+			keyframe = true;
+		current[f.FleetID()] = f.TurnsRemaining();
+	}
+
+	record.clear();
+	Put<unsigned int>(record, 0);
+	Put<unsigned int>(record, turn);
+	Put<unsigned char>(record, keyframe);
+
+	const size_t planetCount = record.size();
+	Put<unsigned short>(record, 0);
+	int count = 0;
+	for (int i = 0; i < numPlanets; i++)
+	{
+		const Planet& p = AP[i];
+		if (!keyframe && p.Owner() == owners[i] && p.NumShips() == ships[i])
+			continue;
+
+		Put<unsigned short>(record, i);
+		Put<unsigned char>(record, p.Owner());
+		Put<int>(record, p.NumShips());
+		owners[i] = p.Owner();
+		ships[i]  = p.NumShips();
+		count++;
+	}
+	Patch<unsigned short>(record, planetCount, count);
+
+	const size_t fleetCount = record.size();
+	Put<unsigned short>(record, 0);
+	count = 0;
+	for (unsigned int i = 0, n = AF.size(); i < n; i++)
+	{
+		const Fleet& f = AF[i];
+		if (!keyframe && fleets.find(f.FleetID()) != fleets.end())
+			continue;
+
+		Put<int>(record, f.FleetID());
+		Put<unsigned char>(record, f.Owner());
+		Put<int>(record, f.NumShips());
+		Put<unsigned short>(record, f.SourcePlanet());
+		Put<unsigned short>(record, f.DestinationPlanet());
+		Put<unsigned short>(record, f.TotalTripLength());
+		Put<unsigned short>(record, f.TurnsRemaining());
+		count++;
+	}
+	Patch<unsigned short>(record, fleetCount, count);
+
+	const size_t landedCount = record.size();
+	Put<unsigned short>(record, 0);
+	count = 0;
+	for (std::map<int, int>::iterator i = fleets.begin(); !keyframe && i != fleets.end(); i++)
+	{
+		if (current.find(i->first) != current.end())
+			continue;
+
+		Put<int>(record, i->first);
+		count++;
+	}
+	Patch<unsigned short>(record, landedCount, count);
+
+	fleets.swap(current);
+	orders.clear();
+	numOrders = 0;
+}
+
+void TraceWriter::Order(const Fleet& order) {
+	if (file == NULL)
+		return;
+
+	Put<unsigned short>(orders, order.SourcePlanet());
+	Put<unsigned short>(orders, order.DestinationPlanet());
+	Put<int>(orders, order.NumShips());
+	numOrders++;
+}
+
+void TraceWriter::EndTurn() {
+	if (file == NULL || record.empty())
+		return;
+
+	Put<unsigned short>(record, numOrders);
+	record.insert(record.end(), orders.begin(), orders.end());
+	Patch<unsigned int>(record, 0, record.size());
+
+	fseek(file, end, SEEK_SET);
+	fwrite(&record[0], 1, record.size(), file);
+	offsets.push_back(end);
+	end += record.size();
+
+	fwrite(&offsets[0], sizeof(unsigned long long), offsets.size(), file);
+	const unsigned int turns = offsets.size();
+	fwrite(&turns, sizeof(turns), 1, file);
+	fwrite("PWTI", 1, 4, file);
+	fflush(file);
+	record.clear();
+}
+
+TraceReader::TraceReader() {
+}
+
+TraceReader::~TraceReader() {
+	for (unsigned int i = 0, n = games.size(); i < n; i++)
+		munmap(const_cast<char*>(games[i].data), games[i].size);
+}
+
+bool TraceReader::Open(const char* path) {
+	const int fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) == -1 || st.st_size < HEADER_SIZE)
+	{
+		close(fd);
+		return false;
+	}
+
+	void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return false;
+
+	Game game;
+	game.data = static_cast<const char*>(data);
+	game.size = st.st_size;
+	const char* p = game.data;
+	if (memcmp(p, "PWTR", 4) != 0)
+	{
+		munmap(data, game.size);
+		return false;
+	}
+	p += 4;
+	const int version = Get<unsigned short>(p);
+	game.numPlanets   = Get<unsigned short>(p);
+	game.planets      = p;
+	const size_t start = HEADER_SIZE + game.numPlanets*PLANET_SIZE;
+	if (version != VERSION || start > game.size)
+	{
+		munmap(data, game.size);
+		return false;
+	}
+	Index(game, start);
+	games.push_back(game);
+	return true;
+}
+
+// uses the index at the end of the file, when the bot was killed while
+// writing it the records are walked instead
+void TraceReader::Index(Game& game, size_t start) {
+	const char* p = game.data + game.size - 8;
+	if (game.size >= start + 8 && memcmp(p + 4, "PWTI", 4) == 0)
+	{
+		const unsigned int turns = Get<unsigned int>(p);
+		if (game.size - 8 - start >= turns*sizeof(unsigned long long))
+		{
+			const char* index = game.data + game.size - 8 - turns*sizeof(unsigned long long);
+			game.offsets.resize(turns);
+			if (turns > 0)
+				memcpy(&game.offsets[0], index, turns*sizeof(unsigned long long));
+
+			bool valid = true;
+			for (unsigned int i = 0; i < turns && valid; i++)
+				valid = game.offsets[i] >= start && game.offsets[i] + RECORD_SIZE <= size_t(index - game.data);
+			if (valid)
+				return;
+		}
+	}
+
+	game.offsets.clear();
+	size_t offset = start;
+	while (offset + RECORD_SIZE <= game.size)
+	{
+		const char* q = game.data + offset;
+		const unsigned int size = Get<unsigned int>(q);
+		if (size < RECORD_SIZE || offset + size > game.size || !Valid(game, offset, size))
+			break;
+
+		game.offsets.push_back(offset);
+		offset += size;
+	}
+}
+
+// the counts of a record add up to its size and the planet ids exist
+bool TraceReader::Valid(const Game& game, size_t offset, size_t size) const {
+	const char* p   = game.data + offset + 9;
+	const char* end = game.data + offset + size;
+	const int planets = Get<unsigned short>(p);
+	for (int j = 0; j < planets && p + 7 <= end; j++, p += 5)
+		if (Get<unsigned short>(p) >= game.numPlanets)
+			return false;
+	if (p + 2 > end)
+		return false;
+
+	p += Get<unsigned short>(p)*FLEET_SIZE;
+	if (p + 2 > end)
+		return false;
+
+	p += Get<unsigned short>(p)*4;
+	if (p + 2 > end)
+		return false;
+
+	return p + 2 + Get<unsigned short>(p)*8 == end;
+}
+
+int TraceReader::Turn(int game, int i) const {
+	const char* p = games[game].data + games[game].offsets[i] + 4;
+	return Get<unsigned int>(p);
+}
+
+bool TraceReader::Read(int g, int i, PlanetVec& AP, FleetVec& AF, FleetVec* orders) const {
+	if (g < 0 || g >= Games() || i < 0 || i >= Turns(g))
+		return false;
+
+	// replay from the closest keyframe, at most KEYFRAME records back
+	const Game& game = games[g];
+	int k = i;
+	while (k > 0 && game.data[game.offsets[k] + 8] == 0)
+		k--;
+
+	AP.clear();
+	AF.clear();
+	const char* p = game.planets;
+	for (int j = 0; j < game.numPlanets; j++)
+	{
+		const double x   = Get<double>(p);
+		const double y   = Get<double>(p);
+		const int growth = Get<int>(p);
+		AP.push_back(Planet(j, 0, 0, growth, x, y));
+	}
+
+	for (; k <= i; k++)
+		Apply(game.data + game.offsets[k], AP, AF, (k == i)? orders: NULL);
+	return true;
+}
+
+void TraceReader::Apply(const char* p, PlanetVec& AP, FleetVec& AF, FleetVec* orders) const {
+	p += 4 + 4; // size, turn
+	const bool keyframe = Get<unsigned char>(p) != 0;
+	if (keyframe)
+	{
+		AF.clear();
+	}
+	else
+	{
+		for (unsigned int j = 0, n = AF.size(); j < n; j++)
+			AF[j].TurnsRemaining(AF[j].TurnsRemaining() - 1);
+	}
+
+	for (int j = 0, n = Get<unsigned short>(p); j < n; j++)
+	{
+		const int id = Get<unsigned short>(p);
+		AP[id].Owner(Get<unsigned char>(p));
+		AP[id].NumShips(Get<int>(p));
+	}
+
+	const char* launched = p;
+	const int numLaunched = Get<unsigned short>(p);
+	p += numLaunched*FLEET_SIZE;
+	for (int j = 0, n = Get<unsigned short>(p); j < n; j++)
+	{
+		const int id = Get<int>(p);
+		for (unsigned int l = 0, m = AF.size(); l < m; l++)
+		{
+			if (AF[l].FleetID() == id)
+			{
+				AF.erase(AF.begin() + l);
+				break;
+			}
+		}
+	}
+
+	const char* end = p;
+	p = launched + 2;
+	for (int j = 0; j < numLaunched; j++)
+	{
+		const int id     = Get<int>(p);
+		const int owner  = Get<unsigned char>(p);
+		const int ships  = Get<int>(p);
+		const int source = Get<unsigned short>(p);
+		const int dest   = Get<unsigned short>(p);
+		const int trip   = Get<unsigned short>(p);
+		const int turns  = Get<unsigned short>(p);
+		Fleet f(owner, ships, source, dest, trip, turns);
+		f.FleetID(id);
+		AF.push_back(f);
+	}
+
+	if (orders != NULL)
+	{
+		p = end;
+		orders->clear();
+		for (int j = 0, n = Get<unsigned short>(p); j < n; j++)
+		{
+			const int source = Get<unsigned short>(p);
+			const int dest   = Get<unsigned short>(p);
+			const int ships  = Get<int>(p);
+			const int trip   = AP[source].Distance(AP[dest]);
+			orders->push_back(Fleet(1, ships, source, dest, trip, trip));
+		}
+	}
+}
@@ -0,0 +1,83 @@
+#ifndef TRACE_
+#define TRACE_
+
+#include "PlanetWars.h"
+
+#include <cstdio>
+#include <map>
+#include <vector>
+
+// Binary game trace. The file starts with the static planet data, followed
+// by one record per turn and an index of the record offsets:
+//
+//   header  "PWTR" u32, version u16, planets u16, per planet x f64, y f64, growth i32
+//   record  size u32, turn u32, flags u8,
+//           planets u16 x (id u16, owner u8, ships i32),
+//           new fleets u16 x (id i32, owner u8, ships i32, source u16, dest u16, trip u16, turns u16),
+//           landed fleets u16 x (id i32),
+//           orders u16 x (source u16, dest u16, ships i32)
+//   index   offsets u64 x turns, turns u32, "PWTI" u32
+//
+// Every KEYFRAME turns a record holds all planets and fleets, the other
+// records only hold the planets that changed, the fleets that were launched
+// and the ids of the fleets that landed. The index is rewritten after every
+// record, so the file is complete even when the bot gets killed.
+class TraceWriter {
+public:
+	TraceWriter(const char* path);
+	~TraceWriter();
+
+	bool Good() const { return file != NULL; }
+
+	// the state as parsed, before DoTurn works on it
+	void BeginTurn(int turn, const PlanetVec& AP, const FleetVec& AF);
+	void Order(const Fleet& order);
+	void EndTurn();
+
+private:
+	typedef std::vector<char> Buffer;
+
+	FILE*  file;
+	long   end;       // end of the last record, the index follows
+	Buffer record;
+	Buffer orders;
+	int    numOrders;
+	int    numPlanets;
+	std::vector<unsigned long long> offsets;
+	std::vector<int> owners, ships;    // planets of the previous turn
+	std::map<int, int> fleets;         // ids of the fleets of the previous turn
+};
+
+// Maps any number of trace files and reconstructs the state of any turn,
+// the record of a turn is found through the index in constant time.
+class TraceReader {
+public:
+	TraceReader();
+	~TraceReader();
+
+	bool Open(const char* path); // adds a game, false when it is no trace
+	int  Games() const { return games.size(); }
+	int  Turns(int game) const { return games[game].offsets.size(); }
+
+	// state at the start of the i-th recorded turn of a game and the orders
+	// issued that turn, orders may be NULL
+	bool Read(int game, int i, PlanetVec& AP, FleetVec& AF, FleetVec* orders) const;
+	int  Turn(int game, int i) const; // turn number of the i-th record
+
+private:
+	struct Game {
+		const char*    data;
+		size_t         size;
+		int            numPlanets;
+		const char*    planets; // static planet data in the header
+		std::vector<unsigned long long> offsets;
+	};
+
+	std::vector<Game> games;
+
+	void Index(Game& game, size_t start);
+	bool Valid(const Game& game, size_t offset, size_t size) const;
+	void Apply(const char* p, PlanetVec& AP, FleetVec& AF, FleetVec* orders) const;
+};
+
+#endif
@@ -0,0 +1,97 @@
+#include "Bot.h"
+#include "MapCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <dirent.h>
+
+// Fills the map cache from a directory of map files, so that the first
+// game on a map does not spend its first turn on the tables. Every map is
+// played for one turn from both sides, which saves the router tables and
+// the turn 0 expansion of either player.
+//
+//   warm <cache dir> <map dir>
+
+// the state as the other player sees it
+static std::string Swap(const std::string& state) {
+	std::istringstream in(state);
+	std::ostringstream out;
+	std::string line;
+	while (std::getline(in, line))
+	{
+		std::istringstream fields(line);
+		std::string type;
+		fields >> type;
+		// the field of the owner, after "P x y" and after "F"
+		const int owner = (type == "P")? 2: (type == "F")? 0: -1;
+		std::vector<std::string> f;
+		for (std::string s; fields >> s;)
+			f.push_back(s);
+		if (owner < 0 || int(f.size()) <= owner)
+		{
+			out << line << "\n";
+			continue;
+		}
+		if (f[owner] == "1" || f[owner] == "2")
+			f[owner] = (f[owner] == "1")? "2": "1";
+		out << type;
+		for (unsigned int i = 0; i < f.size(); i++)
+			out << " " << f[i];
+		out << "\n";
+	}
+	return out.str();
+}
+
+int main(int argc, char *argv[]) {
+	if (argc != 3)
+	{
+		fprintf(stderr, "usage: %s <cache dir> <map dir>\n", argv[0]);
+		return 1;
+	}
+	if (!MapCache::Open(argv[1]))
+	{
+		fprintf(stderr, "%s: can not use %s\n", argv[0], argv[1]);
+		return 1;
+	}
+
+	DIR* dir = opendir(argv[2]);
+	if (dir == NULL)
+	{
+		fprintf(stderr, "%s: can not read %s\n", argv[0], argv[2]);
+		return 1;
+	}
+	std::vector<std::string> names;
+	for (struct dirent* e = readdir(dir); e != NULL; e = readdir(dir))
+		if (e->d_name[0] != '.')
+			names.push_back(e->d_name);
+	closedir(dir);
+	sort(names.begin(), names.end());
+
+	int warmed = 0;
+	for (unsigned int i = 0, n = names.size(); i < n; i++)
+	{
+		const std::string path = std::string(argv[2]) + "/" + names[i];
+		std::ifstream file(path.c_str());
+		std::stringstream map;
+		map << file.rdbuf();
+		if (!file)
+			continue;
+
+		const std::string sides[2] = { map.str(), Swap(map.str()) };
+		bool ok = true;
+		for (int side = 0; side < 2; side++)
+		{
+			Bot bot;
+			std::vector<Fleet> orders;
+			ok = bot.Play(sides[side], orders) && !bot.State().Planets().empty() && ok;
+		}
+		printf("%s %s\n", path.c_str(), ok? "warmed": "does not parse");
+		warmed += ok;
+	}
+	printf("%d of %d maps warmed\n", warmed, int(names.size()));
+	return 0;
+}